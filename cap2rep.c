@@ -0,0 +1,259 @@
+/*
+ * cap2rep.c - Convert mmcapture files into a .rep trace for the driver
+ *
+ * Capture files record block addresses, traces refer to blocks by
+ * id. The events of all capture files are merged in time stamp order
+ * and every allocation gets a fresh id, so an address that is freed
+ * and handed out again becomes a new block, as it should. A block that
+ * is allocated at an address that is still live (its free was dropped
+ * from a full ring) frees the old id first. Frees and reallocs of
+ * blocks allocated before capture started are skipped, and blocks
+ * still live at the end are freed so the trace is balanced.
+ *
+ * usage: cap2rep [-o out.rep] capture-file...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "mmcapture.h"
+
+#define ADDR_HASH 65536
+
+/* An event with its position in the input, for a stable merge */
+typedef struct {
+    cap_event_t ev;
+    unsigned long seq;
+} event_t;
+
+/* A trace operation */
+typedef struct {
+    char type;          /* 'a', 'r' or 'f' */
+    int id;
+    unsigned int size;
+} op_t;
+
+/* Live block: address -> trace id */
+typedef struct live {
+    struct live *next;
+    unsigned long long addr;
+    int id;
+    unsigned int size;
+} live_t;
+
+static event_t *events;
+static unsigned long num_events, max_events;
+static op_t *ops;
+static int num_ops, max_ops;
+static live_t *live[ADDR_HASH];
+static size_t live_bytes, peak_bytes;
+static unsigned long skipped;
+
+static void usage(void);
+static void app_error(char *msg);
+
+/*
+ * read_capture - Append the events of one capture file
+ */
+static void read_capture(char *path)
+{
+    char magic[sizeof(CAP_MAGIC)];
+    cap_event_t ev;
+    FILE *fp;
+
+    if ((fp = fopen(path, "rb")) == NULL) {
+	fprintf(stderr, "Could not open %s\n", path);
+	exit(1);
+    }
+    if (fread(magic, 1, strlen(CAP_MAGIC), fp) != strlen(CAP_MAGIC) ||
+	memcmp(magic, CAP_MAGIC, strlen(CAP_MAGIC)) != 0) {
+	fprintf(stderr, "%s is not a capture file\n", path);
+	exit(1);
+    }
+    while (fread(&ev, sizeof(ev), 1, fp) == 1) {
+	if (num_events == max_events) {
+	    max_events = max_events ? 2 * max_events : 4096;
+	    if ((events = realloc(events, max_events * sizeof(event_t))) == NULL)
+		app_error("realloc failed in read_capture");
+	}
+	events[num_events].ev = ev;
+	events[num_events].seq = num_events;
+	num_events++;
+    }
+    fclose(fp);
+}
+
+/*
+ * cmp_events - Order by time stamp, then by input position
+ */
+static int cmp_events(const void *a, const void *b)
+{
+    const event_t *x = a, *y = b;
+
+    if (x->ev.tsc != y->ev.tsc)
+	return x->ev.tsc < y->ev.tsc ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+static void add_op(char type, int id, unsigned int size)
+{
+    if (num_ops == max_ops) {
+	max_ops = max_ops ? 2 * max_ops : 4096;
+	if ((ops = realloc(ops, max_ops * sizeof(op_t))) == NULL)
+	    app_error("realloc failed in add_op");
+    }
+    ops[num_ops].type = type;
+    ops[num_ops].id = id;
+    ops[num_ops].size = size;
+    num_ops++;
+}
+
+/*
+ * live_remove - Unmap a live address, returning its node (or NULL)
+ */
+static live_t *live_remove(unsigned long long addr)
+{
+    live_t **lp, *l;
+
+    for (lp = &live[(addr >> 3) % ADDR_HASH]; (l = *lp) != NULL; lp = &l->next) {
+	if (l->addr == addr) {
+	    *lp = l->next;
+	    live_bytes -= l->size;
+	    return l;
+	}
+    }
+    return NULL;
+}
+
+/*
+ * live_insert - Map addr to id, reusing node l if given
+ */
+static void live_insert(live_t *l, unsigned long long addr, int id,
+			unsigned int size)
+{
+    if (l == NULL && (l = malloc(sizeof(live_t))) == NULL)
+	app_error("malloc failed in live_insert");
+    l->addr = addr;
+    l->id = id;
+    l->size = size;
+    l->next = live[(addr >> 3) % ADDR_HASH];
+    live[(addr >> 3) % ADDR_HASH] = l;
+    live_bytes += size;
+    if (live_bytes > peak_bytes)
+	peak_bytes = live_bytes;
+}
+
+int main(int argc, char **argv)
+{
+    char *outname = NULL;
+    FILE *out = stdout;
+    unsigned long i;
+    int c, num_ids = 0;
+    live_t *l, *lost;
+
+    while ((c = getopt(argc, argv, "ho:")) != EOF) {
+	switch (c) {
+	case 'o':
+	    outname = optarg;
+	    break;
+	case 'h':
+	default:
+	    usage();
+	    exit(c == 'h' ? 0 : 1);
+	}
+    }
+    if (optind == argc) {
+	usage();
+	exit(1);
+    }
+    for (; optind < argc; optind++)
+	read_capture(argv[optind]);
+    qsort(events, num_events, sizeof(event_t), cmp_events);
+
+    for (i = 0; i < num_events; i++) {
+	cap_event_t *e = &events[i].ev;
+
+	switch (e->op) {
+	case 'a':
+	    if ((l = live_remove(e->addr)) != NULL)   /* lost free */
+		add_op('f', l->id, 0);
+	    add_op('a', num_ids, e->size);
+	    live_insert(l, e->addr, num_ids++, e->size);
+	    break;
+	case 'r':
+	    l = live_remove(e->old);
+	    if ((lost = live_remove(e->addr)) != NULL) {  /* lost free */
+		add_op('f', lost->id, 0);
+		free(lost);
+	    }
+	    if (l == NULL) {    /* allocated before capture */
+		skipped++;
+		add_op('a', num_ids, e->size);
+		live_insert(NULL, e->addr, num_ids++, e->size);
+		break;
+	    }
+	    add_op('r', l->id, e->size);
+	    live_insert(l, e->addr, l->id, e->size);
+	    break;
+	case 'f':
+	    if ((l = live_remove(e->addr)) == NULL) {
+		skipped++;
+		break;
+	    }
+	    add_op('f', l->id, 0);
+	    free(l);
+	    break;
+	default:
+	    fprintf(stderr, "Bad event type '%c' ignored\n", e->op);
+	}
+    }
+
+    /* balance the trace */
+    for (c = 0; c < ADDR_HASH; c++) {
+	while ((l = live[c]) != NULL) {
+	    live[c] = l->next;
+	    add_op('f', l->id, 0);
+	    free(l);
+	}
+    }
+
+    if (outname && (out = fopen(outname, "w")) == NULL) {
+	fprintf(stderr, "Could not open %s\n", outname);
+	exit(1);
+    }
+    fprintf(out, "%lu\n%d\n%d\n%d\n", (unsigned long)peak_bytes, num_ids,
+	    num_ops, 1);
+    for (c = 0; c < num_ops; c++) {
+	if (ops[c].type == 'f')
+	    fprintf(out, "f %d\n", ops[c].id);
+	else
+	    fprintf(out, "%c %d %u\n", ops[c].type, ops[c].id, ops[c].size);
+    }
+    if (out != stdout)
+	fclose(out);
+    fprintf(stderr, "%lu events, %d ids, %d ops, %lu events on unknown blocks skipped\n",
+	    num_events, num_ids, num_ops, skipped);
+    return 0;
+}
+
+/*
+ * app_error - Report an arbitrary application error
+ */
+static void app_error(char *msg)
+{
+    printf("%s\n", msg);
+    exit(1);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: cap2rep [-h] [-o <file>] <capture>...\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-o <file>  Write the trace to <file> instead of stdout.\n");
+}
@@ -10,9 +10,13 @@
 
 /*
  * This is the default path where the driver will look for the
- * default tracefiles. You can override it at runtime with the -t flag.
+ * default tracefiles. You can override it at runtime with the -t flag,
+ * or at build time with -DTRACEDIR=... ("make traces" generates a
+ * synthetic suite in ./traces/).
  */
+#ifndef TRACEDIR
 #define TRACEDIR "/labs/sty15/data/traces/"
+#endif
 
 /*
  * This is the list of default tracefiles in TRACEDIR that the driver
@@ -58,9 +62,11 @@
 #define ALIGNMENT 8  
 
 /* 
- * Maximum heap size in bytes 
+ * Maximum heap size in bytes (the LD_PRELOAD shim reserves more)
  */
+#ifndef MAX_HEAP
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
+#endif
 
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
@@ -0,0 +1,170 @@
+/*
+ * fcache.c - Put the caches in a known state before a measurement
+ *
+ * fcyc.c's clear() reads a fixed 512 KB buffer with a 32 byte stride,
+ * which leaves most of a modern L2 and all of the LLC warm and touches
+ * only every other 64 byte line. Here the geometry comes from
+ * /sys/devices/system/cpu/cpu0/cache: the L2 is the unified level 2
+ * cache, the LLC the highest level found, and the stride is the
+ * coherency line size.
+ *
+ * Eviction writes a buffer twice the size of the target cache, so
+ * that the lines it replaces are gone whatever the replacement policy
+ * and the lines it leaves behind are dirty (as they would be after
+ * real work). To make sure a particular region, e.g. the allocator's
+ * heap, starts cold, fcache_flush issues a clflush per line of it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fcache.h"
+
+/* Defaults when sysfs cannot be read */
+#define LINE 64
+#define L2_BYTES (1L << 20)
+#define LLC_BYTES (32L << 20)
+
+#define SYSFS_CACHE "/sys/devices/system/cpu/cpu0/cache/index%d/%s"
+#define MAX_INDEX 16
+
+static int line = LINE;
+static long l2_bytes = L2_BYTES;
+static long llc_bytes = LLC_BYTES;
+
+static char *buf = NULL;
+static long buf_bytes = 0;
+
+static const char *names[] = { "hot", "l2", "llc" };
+
+/*
+ * read_attr - Read one attribute of a sysfs cache index into value
+ *     (of size len). Returns 1 on success.
+ */
+static int read_attr(int index, const char *attr, char *value, int len)
+{
+    char path[128];
+    FILE *fp;
+    int ok;
+
+    snprintf(path, sizeof(path), SYSFS_CACHE, index, attr);
+    if ((fp = fopen(path, "r")) == NULL)
+	return 0;
+    ok = fgets(value, len, fp) != NULL;
+    fclose(fp);
+    if (ok)
+	value[strcspn(value, "\n")] = '\0';
+    return ok;
+}
+
+/*
+ * parse_size - Parse a sysfs cache size such as "48K" or "8M"
+ */
+static long parse_size(const char *s)
+{
+    char *end;
+    long n = strtol(s, &end, 10);
+
+    if (*end == 'K')
+	n <<= 10;
+    else if (*end == 'M')
+	n <<= 20;
+    return n;
+}
+
+/*
+ * init_fcache - Find the L2, the LLC and the line size
+ */
+void init_fcache(void)
+{
+    char value[64];
+    int i, level, llc_level = 0;
+    long size;
+
+    for (i = 0; i < MAX_INDEX; i++) {
+	if (!read_attr(i, "level", value, sizeof(value)))
+	    break;
+	level = atoi(value);
+	if (!read_attr(i, "type", value, sizeof(value)) ||
+	    strcmp(value, "Instruction") == 0)
+	    continue;
+	if (!read_attr(i, "size", value, sizeof(value)) ||
+	    (size = parse_size(value)) <= 0)
+	    continue;
+	if (level == 2)
+	    l2_bytes = size;
+	if (level >= llc_level) {
+	    llc_level = level;
+	    llc_bytes = size;
+	}
+	if (read_attr(i, "coherency_line_size", value, sizeof(value)) &&
+	    atoi(value) > 0)
+	    line = atoi(value);
+    }
+}
+
+int fcache_line(void)
+{
+    return line;
+}
+
+long fcache_size(int mode)
+{
+    return mode == FCACHE_L2 ? l2_bytes : mode == FCACHE_LLC ? llc_bytes : 0;
+}
+
+int fcache_mode(const char *name)
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+	if (strcmp(name, names[i]) == 0)
+	    return i;
+    return -1;
+}
+
+const char *fcache_name(int mode)
+{
+    return mode >= 0 && mode < 3 ? names[mode] : "?";
+}
+
+/*
+ * fcache_evict - Write one byte per line of a buffer twice the size
+ *     of the cache
+ */
+void fcache_evict(int mode)
+{
+    long bytes = 2 * fcache_size(mode), i;
+
+    if (bytes == 0)
+	return;
+    if (bytes > buf_bytes) {
+	free(buf);
+	if ((buf = malloc(bytes)) == NULL) {
+	    fprintf(stderr, "Fatal error.  Malloc returned null when trying to evict cache\n");
+	    exit(1);
+	}
+	buf_bytes = bytes;
+    }
+    for (i = 0; i < bytes; i += line)
+	((volatile char *)buf)[i]++;
+}
+
+/*
+ * fcache_flush - clflush every line of [lo, hi]
+ */
+int fcache_flush(void *lo, void *hi)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    char *p = (char *)((unsigned long)lo & ~(unsigned long)(line - 1));
+
+    for (; p <= (char *)hi; p += line)
+	__asm__ volatile("clflush (%0)" : : "r"(p) : "memory");
+    __asm__ volatile("mfence" : : : "memory");
+    return 1;
+#else
+    (void)lo;
+    (void)hi;
+    return 0;
+#endif
+}
@@ -0,0 +1,42 @@
+/*
+ * fcache.h - prototypes for the routines in fcache.c that put the
+ *     cache hierarchy in a known state before a measurement
+ */
+
+/* Cache states a measurement can start from */
+#define FCACHE_HOT  0    /* whatever the previous run left: warm */
+#define FCACHE_L2   1    /* L1 and L2 evicted, LLC left alone */
+#define FCACHE_LLC  2    /* every level evicted */
+
+/*
+ * init_fcache - Read the cache geometry of cpu0 from sysfs. Levels
+ *     that cannot be read keep conservative defaults (64 byte lines,
+ *     1 MB L2, 32 MB LLC).
+ */
+void init_fcache(void);
+
+/* fcache_line - Cache line size in bytes */
+int fcache_line(void);
+
+/* fcache_size - Size in bytes of the cache evicted by mode */
+long fcache_size(int mode);
+
+/* fcache_mode - Parse "hot", "l2" or "llc"; returns -1 otherwise */
+int fcache_mode(const char *name);
+
+/* fcache_name - Printable name of a mode */
+const char *fcache_name(int mode);
+
+/*
+ * fcache_evict - Evict the caches for mode by writing a buffer twice
+ *     the size of the cache, one store per line. Does nothing for
+ *     FCACHE_HOT.
+ */
+void fcache_evict(int mode);
+
+/*
+ * fcache_flush - Flush the lines of [lo, hi] from every cache level
+ *     with clflush. Returns 0 if the instruction is not available on
+ *     this machine, 1 otherwise.
+ */
+int fcache_flush(void *lo, void *hi);
@@ -0,0 +1,189 @@
+/*
+ * fperf.c - Count the hardware events caused by a function f
+ *
+ * Uses the Linux perf_event_open interface to count cycles,
+ * instructions, L1D/LLC/dTLB read misses and branch misses while
+ * f(argp) runs. Each event is opened on its own, so an event the PMU
+ * (or the kernel's perf_event_paranoid setting) does not allow is
+ * simply reported as unavailable instead of disabling all of them.
+ * On other systems every event is unavailable.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fperf.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* Printable event names, indexed by FPERF_xxx */
+static const char *names[FPERF_NEVENTS] = {
+    "cycles", "instrs", "L1D-miss", "LLC-miss", "dTLB-miss", "br-miss"
+};
+
+static int fds[FPERF_NEVENTS] = { -1, -1, -1, -1, -1, -1 };
+static int initialized = 0;
+
+#ifdef __linux__
+
+/* Value layout of a counter opened with the read_format used below */
+struct read_value {
+    unsigned long long value;
+    unsigned long long time_enabled;
+    unsigned long long time_running;
+};
+
+/*
+ * cache_config - Encode a read miss of a hardware cache for
+ *     PERF_TYPE_HW_CACHE
+ */
+static unsigned long long cache_config(int cache)
+{
+    return cache |
+	(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+/*
+ * open_event - Open a disabled, user-space only counter for the
+ *     calling thread. Returns the descriptor or -1.
+ */
+static int open_event(unsigned type, unsigned long long config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+	PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+/*
+ * init_fperf - Open the counters, returning how many are available
+ */
+int init_fperf(void)
+{
+    int i, n = 0;
+
+    if (initialized)
+	deinit_fperf();
+#ifdef __linux__
+    fds[FPERF_CYCLES] = open_event(PERF_TYPE_HARDWARE,
+				   PERF_COUNT_HW_CPU_CYCLES);
+    fds[FPERF_INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE,
+					 PERF_COUNT_HW_INSTRUCTIONS);
+    fds[FPERF_L1D_MISSES] = open_event(PERF_TYPE_HW_CACHE,
+				       cache_config(PERF_COUNT_HW_CACHE_L1D));
+    fds[FPERF_LLC_MISSES] = open_event(PERF_TYPE_HW_CACHE,
+				       cache_config(PERF_COUNT_HW_CACHE_LL));
+    fds[FPERF_DTLB_MISSES] = open_event(PERF_TYPE_HW_CACHE,
+					cache_config(PERF_COUNT_HW_CACHE_DTLB));
+    fds[FPERF_BRANCH_MISSES] = open_event(PERF_TYPE_HARDWARE,
+					  PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+    for (i = 0; i < FPERF_NEVENTS; i++)
+	if (fds[i] >= 0)
+	    n++;
+    initialized = 1;
+    return n;
+}
+
+/*
+ * deinit_fperf - Close all open counters
+ */
+void deinit_fperf(void)
+{
+    int i;
+
+    for (i = 0; i < FPERF_NEVENTS; i++) {
+	if (fds[i] >= 0)
+	    close(fds[i]);
+	fds[i] = -1;
+    }
+    initialized = 0;
+}
+
+/*
+ * fperf - Count the events caused by one call of f(argp)
+ */
+void fperf(fperf_test_funct f, void *argp, fperf_t *result)
+{
+    int i;
+
+    if (!initialized)
+	init_fperf();
+    memset(result, 0, sizeof(*result));
+
+#ifdef __linux__
+    for (i = 0; i < FPERF_NEVENTS; i++) {
+	if (fds[i] >= 0) {
+	    ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+    }
+    f(argp);
+    for (i = 0; i < FPERF_NEVENTS; i++) {
+	if (fds[i] >= 0)
+	    ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    for (i = 0; i < FPERF_NEVENTS; i++) {
+	struct read_value rv;
+
+	if (fds[i] < 0 || read(fds[i], &rv, sizeof(rv)) != sizeof(rv))
+	    continue;
+	if (rv.time_running == 0)   /* never scheduled on the PMU */
+	    continue;
+	result->valid[i] = 1;
+	result->count[i] = (double)rv.value;
+	/* scale up if the event was multiplexed with others */
+	if (rv.time_running < rv.time_enabled)
+	    result->count[i] *= (double)rv.time_enabled / rv.time_running;
+    }
+#else
+    f(argp);
+#endif
+}
+
+/*
+ * fperf_name - Short printable name of an event
+ */
+const char *fperf_name(int event)
+{
+    if (event < 0 || event >= FPERF_NEVENTS)
+	return "?";
+    return names[event];
+}
+
+/*
+ * print_fperf - Print the per-operation counts of result
+ */
+void print_fperf(FILE *fp, fperf_t *result, int nops)
+{
+    int i;
+
+    if (nops <= 0)
+	nops = 1;
+    for (i = 0; i < FPERF_NEVENTS; i++) {
+	if (result->valid[i])
+	    fprintf(fp, "%s/op %8.2f  ", names[i], result->count[i] / nops);
+	else
+	    fprintf(fp, "%s/op %8s  ", names[i], "n/a");
+    }
+    if (result->valid[FPERF_CYCLES] && result->valid[FPERF_INSTRUCTIONS] &&
+	result->count[FPERF_CYCLES] > 0)
+	fprintf(fp, "IPC %.2f",
+		result->count[FPERF_INSTRUCTIONS] / result->count[FPERF_CYCLES]);
+    fprintf(fp, "\n");
+}
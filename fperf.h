@@ -0,0 +1,47 @@
+/*
+ * fperf.h - prototypes for the routines in fperf.c that collect
+ *     hardware performance counters (via perf_event_open) while
+ *     running a test function f
+ */
+#include <stdio.h>
+
+/* The test function takes a generic pointer as input */
+typedef void (*fperf_test_funct)(void *);
+
+/* The hardware events collected around each call of f */
+#define FPERF_CYCLES        0
+#define FPERF_INSTRUCTIONS  1
+#define FPERF_L1D_MISSES    2
+#define FPERF_LLC_MISSES    3
+#define FPERF_DTLB_MISSES   4
+#define FPERF_BRANCH_MISSES 5
+#define FPERF_NEVENTS       6
+
+/* Counter values gathered by one call of fperf */
+typedef struct {
+    int valid[FPERF_NEVENTS];     /* nonzero if the event could be counted */
+    double count[FPERF_NEVENTS];  /* event count (scaled if multiplexed) */
+} fperf_t;
+
+/*
+ * init_fperf - Open the counters. Returns the number of events that
+ *     are available on this machine (0 if none, e.g. when running in
+ *     a container or with a restrictive perf_event_paranoid).
+ */
+int init_fperf(void);
+
+/* deinit_fperf - Close the counters opened by init_fperf */
+void deinit_fperf(void);
+
+/* fperf - Count the hardware events caused by one call of f(argp) */
+void fperf(fperf_test_funct f, void *argp, fperf_t *result);
+
+/* fperf_name - Short printable name of an event */
+const char *fperf_name(int event);
+
+/*
+ * print_fperf - Print the counters in result divided by nops, e.g.
+ *     the number of operations in the trace that f replayed.
+ *     Unavailable events are printed as "n/a".
+ */
+void print_fperf(FILE *fp, fperf_t *result, int nops);
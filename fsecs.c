@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include "fsecs.h"
 #include "fcyc.h"
+#include "fcache.h"
 #include "clock.h"
 #include "ftimer.h"
 #include "config.h"
@@ -26,6 +27,9 @@ void init_fsecs(void)
     /* set key parameters for the fcyc package */
     set_fcyc_maxsamples(20); 
     set_fcyc_clear_cache(1);
+    init_fcache();
+    set_fcyc_cache_size(2 * fcache_size(FCACHE_LLC));
+    set_fcyc_cache_block(fcache_line());
     set_fcyc_compensate(1);
     set_fcyc_epsilon(0.01);
     set_fcyc_k(3);
@@ -0,0 +1,357 @@
+/*
+ * fstat.c - Time a function f with a statistical summary
+ *
+ * The K-best scheme of fcyc.c returns a single number and says nothing
+ * about how much it can be trusted. Here f is run a few times untimed
+ * to warm up the caches, the branch predictors and the page tables,
+ * then timed over a fixed number of trials, optionally pinned to one
+ * CPU. Samples further than k scaled median absolute deviations from
+ * the median are rejected as outliers (a timer interrupt, a page
+ * fault storm, another process); the rest are summarized by their
+ * median and a percentile bootstrap confidence interval of it.
+ *
+ * Two measurements, e.g. of two builds of the allocator saved with
+ * fstat_write, are compared by bootstrapping the ratio of their
+ * medians: a change is only reported when the interval of the ratio
+ * does not contain 1.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#include "fstat.h"
+
+/* Default values */
+#define WARMUP 2             /* untimed runs */
+#define TRIALS 15            /* timed runs */
+#define OUTLIER 3.0          /* rejection threshold, in scaled MADs */
+#define CONFIDENCE 0.95      /* level of the confidence intervals */
+#define RESAMPLES 2000       /* bootstrap resamples */
+#define SEED 0x2545F4914F6CDD1DULL
+
+#define MAD_SCALE 1.4826     /* MAD of a normal distribution -> sigma */
+
+static int warmup = WARMUP;
+static int trials = TRIALS;
+static int cpu = -1;
+static double outlier = OUTLIER;
+static double confidence = CONFIDENCE;
+static int resamples = RESAMPLES;
+static fstat_test_funct prepare = NULL;
+static void *prepare_arg = NULL;
+
+static unsigned long long rng;
+
+/*
+ * rand_index - Uniform index in [0, n) from a xorshift generator,
+ *     reseeded for every summary so that results are reproducible
+ */
+static int rand_index(int n)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (int)(rng % (unsigned long long)n);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * median - Median of the n sorted values in v
+ */
+static double median(double *v, int n)
+{
+    if (n == 0)
+	return 0;
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+/*
+ * resample_median - Median of n values drawn with replacement from the
+ *     sorted array v, using tmp as scratch space
+ */
+static double resample_median(double *v, int n, double *tmp)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	tmp[i] = v[rand_index(n)];
+    qsort(tmp, n, sizeof(double), cmp_double);
+    return median(tmp, n);
+}
+
+/*
+ * percentile_ci - Central interval at the configured level of the n
+ *     bootstrap estimates in v (sorted in place)
+ */
+static void percentile_ci(double *v, int n, double *lo, double *hi)
+{
+    int l, h;
+
+    qsort(v, n, sizeof(double), cmp_double);
+    l = (int)((1 - confidence) / 2 * n);
+    h = (int)((1 + confidence) / 2 * n);
+    if (h >= n)
+	h = n - 1;
+    *lo = v[l];
+    *hi = v[h];
+}
+
+/*
+ * now - Monotonic time in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * pin - Restrict the calling process to one CPU; returns the previous
+ *     affinity in old
+ */
+static void pin(int c, cpu_set_t *old)
+{
+    cpu_set_t set;
+
+    sched_getaffinity(0, sizeof(*old), old);
+    CPU_ZERO(&set);
+    CPU_SET(c, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0)
+	perror("fstat: sched_setaffinity");
+}
+
+/*
+ * reject_outliers - Drop the samples of result further than outlier
+ *     scaled MADs from the median. The samples must be sorted.
+ */
+static void reject_outliers(fstat_t *result)
+{
+    double med, mad, *dev;
+    int i, n = 0;
+
+    if (outlier <= 0 || result->n < 3)
+	return;
+    if ((dev = malloc(result->n * sizeof(double))) == NULL)
+	return;
+    med = median(result->secs, result->n);
+    for (i = 0; i < result->n; i++)
+	dev[i] = result->secs[i] > med ? result->secs[i] - med
+				       : med - result->secs[i];
+    qsort(dev, result->n, sizeof(double), cmp_double);
+    mad = median(dev, result->n) * MAD_SCALE;
+    free(dev);
+    if (mad == 0)
+	return;
+    for (i = 0; i < result->n; i++) {
+	double d = result->secs[i] - med;
+
+	if ((d < 0 ? -d : d) <= outlier * mad)
+	    result->secs[n++] = result->secs[i];
+    }
+    result->outliers += result->n - n;
+    result->n = n;
+}
+
+/*
+ * fstat - Warm up, time the trials and summarize them
+ */
+int fstat(fstat_test_funct f, void *argp, fstat_t *result)
+{
+    cpu_set_t old;
+    int i;
+
+    memset(result, 0, sizeof(*result));
+    if ((result->secs = malloc(trials * sizeof(double))) == NULL)
+	return -1;
+    if (cpu >= 0)
+	pin(cpu, &old);
+
+    for (i = 0; i < warmup; i++)
+	f(argp);
+    for (i = 0; i < trials; i++) {
+	double start;
+
+	if (prepare)
+	    prepare(prepare_arg);
+	start = now();
+	f(argp);
+	result->secs[i] = now() - start;
+    }
+
+    if (cpu >= 0)
+	sched_setaffinity(0, sizeof(old), &old);
+    result->n = trials;
+    qsort(result->secs, result->n, sizeof(double), cmp_double);
+    reject_outliers(result);
+    fstat_summarize(result);
+    return 0;
+}
+
+/*
+ * fstat_summarize - Median, MAD and bootstrap interval of the median
+ */
+void fstat_summarize(fstat_t *result)
+{
+    double *est, *tmp;
+    int i, n = result->n;
+
+    qsort(result->secs, n, sizeof(double), cmp_double);
+    result->median = result->lo = result->hi = median(result->secs, n);
+    result->mad = 0;
+    if (n < 2)
+	return;
+
+    if ((tmp = malloc(n * sizeof(double))) == NULL)
+	return;
+    for (i = 0; i < n; i++)
+	tmp[i] = result->secs[i] > result->median ?
+	    result->secs[i] - result->median : result->median - result->secs[i];
+    qsort(tmp, n, sizeof(double), cmp_double);
+    result->mad = median(tmp, n);
+
+    if ((est = malloc(resamples * sizeof(double))) != NULL) {
+	rng = SEED;
+	for (i = 0; i < resamples; i++)
+	    est[i] = resample_median(result->secs, n, tmp);
+	percentile_ci(est, resamples, &result->lo, &result->hi);
+	free(est);
+    }
+    free(tmp);
+}
+
+/*
+ * fstat_compare - Bootstrap the ratio of the medians of result and base
+ */
+void fstat_compare(fstat_t *base, fstat_t *result, fstat_diff_t *diff)
+{
+    double *est, *tmp;
+    int i, n = base->n > result->n ? base->n : result->n;
+
+    diff->ratio = base->median > 0 ? result->median / base->median : 0;
+    diff->lo = diff->hi = diff->ratio;
+    diff->verdict = 0;
+    if (base->n < 2 || result->n < 2 || base->median <= 0)
+	return;
+
+    est = malloc(resamples * sizeof(double));
+    tmp = malloc(n * sizeof(double));
+    if (est == NULL || tmp == NULL) {
+	free(est);
+	free(tmp);
+	return;
+    }
+    rng = SEED;
+    for (i = 0; i < resamples; i++) {
+	double b = resample_median(base->secs, base->n, tmp);
+	double r = resample_median(result->secs, result->n, tmp);
+
+	est[i] = b > 0 ? r / b : diff->ratio;
+    }
+    percentile_ci(est, resamples, &diff->lo, &diff->hi);
+    free(est);
+    free(tmp);
+
+    if (diff->lo > 1)
+	diff->verdict = 1;
+    else if (diff->hi < 1)
+	diff->verdict = -1;
+}
+
+/*
+ * fstat_free - Free the samples of result
+ */
+void fstat_free(fstat_t *result)
+{
+    free(result->secs);
+    result->secs = NULL;
+    result->n = 0;
+}
+
+/*
+ * fstat_write - One line: name, number of samples, samples
+ */
+void fstat_write(FILE *fp, const char *name, fstat_t *result)
+{
+    int i;
+
+    fprintf(fp, "%s %d", name, result->n);
+    for (i = 0; i < result->n; i++)
+	fprintf(fp, " %.9g", result->secs[i]);
+    fprintf(fp, "\n");
+}
+
+/*
+ * fstat_read - Read back a line written by fstat_write
+ */
+int fstat_read(FILE *fp, char *name, int len, fstat_t *result)
+{
+    char fmt[32];
+    int i, n;
+
+    memset(result, 0, sizeof(*result));
+    snprintf(fmt, sizeof(fmt), "%%%ds %%d", len - 1);
+    if (fscanf(fp, fmt, name, &n) != 2 || n < 0)
+	return 0;
+    if ((result->secs = malloc((n + 1) * sizeof(double))) == NULL)
+	return 0;
+    for (i = 0; i < n; i++) {
+	if (fscanf(fp, "%lf", &result->secs[i]) != 1) {
+	    fstat_free(result);
+	    return 0;
+	}
+    }
+    result->n = n;
+    fstat_summarize(result);
+    return 1;
+}
+
+/*
+ * Parameter setters
+ */
+void set_fstat_warmup(int warmup_arg)
+{
+    warmup = warmup_arg < 0 ? 0 : warmup_arg;
+}
+
+void set_fstat_trials(int trials_arg)
+{
+    trials = trials_arg < 1 ? 1 : trials_arg;
+}
+
+void set_fstat_cpu(int cpu_arg)
+{
+    cpu = cpu_arg;
+}
+
+void set_fstat_prepare(fstat_test_funct prep, void *argp)
+{
+    prepare = prep;
+    prepare_arg = argp;
+}
+
+void set_fstat_outlier(double k)
+{
+    outlier = k;
+}
+
+void set_fstat_confidence(double level)
+{
+    if (level > 0 && level < 1)
+	confidence = level;
+}
+
+void set_fstat_resamples(int resamples_arg)
+{
+    resamples = resamples_arg < 1 ? 1 : resamples_arg;
+}
@@ -0,0 +1,111 @@
+/*
+ * fstat.h - prototypes for the routines in fstat.c that time a test
+ *     function f over repeated trials and summarize the samples with
+ *     a median and a bootstrap confidence interval
+ */
+#include <stdio.h>
+
+/* The test function takes a generic pointer as input */
+typedef void (*fstat_test_funct)(void *);
+
+/* The samples of one measurement and their summary */
+typedef struct {
+    int n;           /* number of samples kept */
+    int outliers;    /* number of samples rejected as outliers */
+    double *secs;    /* the kept samples, in seconds, sorted */
+    double median;   /* median of the kept samples */
+    double lo, hi;   /* confidence interval of the median */
+    double mad;      /* median absolute deviation of the kept samples */
+} fstat_t;
+
+/* The outcome of comparing a measurement against a baseline */
+typedef struct {
+    double ratio;    /* median / baseline median */
+    double lo, hi;   /* confidence interval of the ratio */
+    int verdict;     /* -1 faster, 0 no significant change, 1 slower */
+} fstat_diff_t;
+
+/*
+ * fstat - Time f(argp): run it warmup times untimed, then trials
+ *     times timed, drop the outliers and summarize the rest in result.
+ *     Returns 0, or -1 if the samples could not be stored.
+ */
+int fstat(fstat_test_funct f, void *argp, fstat_t *result);
+
+/*
+ * fstat_summarize - Recompute the summary of result from its samples,
+ *     e.g. after reading them back with fstat_read
+ */
+void fstat_summarize(fstat_t *result);
+
+/*
+ * fstat_compare - Does result differ significantly from base? The
+ *     ratio of the medians is bootstrapped from both sets of samples;
+ *     the change is significant if its interval excludes 1.
+ */
+void fstat_compare(fstat_t *base, fstat_t *result, fstat_diff_t *diff);
+
+/* fstat_free - Free the samples held by result */
+void fstat_free(fstat_t *result);
+
+/*
+ * fstat_write - Append the samples of result to fp as one line,
+ *     labelled name (which must not contain white space)
+ */
+void fstat_write(FILE *fp, const char *name, fstat_t *result);
+
+/*
+ * fstat_read - Read the next line written by fstat_write into name
+ *     (of size len) and result. Returns 1, or 0 at end of file or on a
+ *     malformed line.
+ */
+int fstat_read(FILE *fp, char *name, int len, fstat_t *result);
+
+/*********************************************************
+ * Set the various parameters used by measurement routines
+ *********************************************************/
+
+/*
+ * set_fstat_warmup - Untimed runs of f before the trials
+ *     Default = 2
+ */
+void set_fstat_warmup(int warmup);
+
+/*
+ * set_fstat_trials - Timed runs of f
+ *     Default = 15
+ */
+void set_fstat_trials(int trials);
+
+/*
+ * set_fstat_cpu - Pin the calling process to this CPU while
+ *     measuring; -1 leaves the affinity alone
+ *     Default = -1
+ */
+void set_fstat_cpu(int cpu);
+
+/*
+ * set_fstat_prepare - Call prep(argp), untimed, before each trial,
+ *     e.g. to put the caches in a known state; NULL for none
+ *     Default = NULL
+ */
+void set_fstat_prepare(fstat_test_funct prep, void *argp);
+
+/*
+ * set_fstat_outlier - Reject samples more than k scaled MADs from the
+ *     median; 0 keeps every sample
+ *     Default = 3.0
+ */
+void set_fstat_outlier(double k);
+
+/*
+ * set_fstat_confidence - Level of the bootstrap confidence intervals
+ *     Default = 0.95
+ */
+void set_fstat_confidence(double level);
+
+/*
+ * set_fstat_resamples - Number of bootstrap resamples
+ *     Default = 2000
+ */
+void set_fstat_resamples(int resamples);
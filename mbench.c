@@ -0,0 +1,1178 @@
+/*
+ * mbench.c - Run the trace suite against the mm.c allocator
+ *
+ * For every trace mbench checks that the allocator handles it
+ * correctly, measures its space utilization and then its throughput,
+ * like the driver. With -j, the correctness and utilization passes of
+ * different traces run in parallel worker processes: each worker is
+ * forked with its own copy of the memlib heap and reports its result
+ * through a pipe. Timing passes are never run in parallel: they run
+ * one after another once all workers are done, optionally pinned to
+ * one CPU with -P, so the throughput numbers are not perturbed by the
+ * other workers.
+ *
+ * Each timing pass is measured by fstat: after -w warm-up runs, -n
+ * timed trials give the median time of the trace and a confidence
+ * interval of it. -o saves the samples; -C compares this build
+ * against samples saved by another one and reports, per trace, whether
+ * the difference is significant. mbench then exits with status 2 if
+ * any trace got significantly slower, so it can gate a change.
+ *
+ * -c sets the cache state each trial starts from: hot (the default,
+ * what the previous trial left), l2 (L1 and L2 evicted) or llc (every
+ * level evicted), with the cache sizes read from sysfs. -F also
+ * flushes the heap itself with clflush, so that the allocator's
+ * metadata is cold however small the heap is.
+ *
+ * -r writes every metric of the run to a file for other tools, as JSON
+ * if its name ends in .json and as CSV otherwise: utilization,
+ * throughput with its interval, per-op latency percentiles (from a
+ * separate pass timing each call, so the timer does not disturb the
+ * throughput numbers), the allocator's mm_stats counters, hardware
+ * counters when fperf can open them, and the build and host the run
+ * was made on. mcompare diffs two CSV result files.
+ *
+ * -T records how the heap evolves during a replay of each trace: every
+ * -N ops (and at the end) it writes a CSV row with the live payload,
+ * the heap size, the free bytes in total and per mm_stats size class,
+ * the largest free block, the number of extend_heap calls so far and
+ * the resident set size of mbench from /proc/self/statm.
+ *
+ * The allocator variants of the registry (mmreg.c) can be benchmarked
+ * side by side: -a selects one (mm, firstfit, libc) and may be
+ * repeated, -A selects all of them. Each variant runs the whole suite
+ * in turn and a comparison table follows the per-variant ones. The
+ * single-variant outputs (-o, -C, -r, -T) describe the first variant.
+ *
+ * usage: mbench [-hvsFA] [-a <alloc>]... [-j <jobs>] [-P <cpu>]
+ *               [-n <trials>] [-w <warmup>] [-c <cache>] [-o <file>]
+ *               [-C <file>] [-r <file>] [-T <file> [-N <ops>]]
+ *               [-t <dir>] [-f <file>]...
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <sys/utsname.h>
+
+#include "mm.h"
+#include "mmreg.h"
+#include "memlib.h"
+#include "fstat.h"
+#include "fcache.h"
+#include "fperf.h"
+#include "config.h"
+#include "trace.h"
+
+#define MAXTRACES 256
+#define MAXALLOCS 16
+
+#ifndef BUILD_ID
+#define BUILD_ID "unknown"
+#endif
+#ifndef BUILD_CFLAGS
+#define BUILD_CFLAGS "unknown"
+#endif
+
+/* Latency percentiles reported per trace */
+#define NLAT 5
+static const double lat_pct[NLAT] = { 50, 90, 99, 99.9, 100 };
+static const char *lat_name[NLAT] = { "p50", "p90", "p99", "p999", "max" };
+
+/* Summarizes the important stats for one trace */
+typedef struct {
+    double ops;      /* number of ops (malloc/free/realloc) in the trace */
+    int valid;       /* was the trace processed correctly by the allocator? */
+    double secs;     /* median number of secs needed to run the trace */
+    double lo, hi;   /* confidence interval of secs */
+    double util;     /* space utilization for this trace */
+    size_t heap;     /* heap size at the end of the trace */
+    mm_stats_t mm;   /* allocator counters at the end of the trace */
+    double lat[NLAT];    /* per-op latency percentiles, in ns */
+    fperf_t perf;    /* hardware counters over one replay */
+} stats_t;
+
+/* Parameters of the timing pass, passed to fstat */
+typedef struct {
+    trace_t *trace;
+    char **blocks;
+} speed_t;
+
+static int verbose = 0;          /* -v */
+static mm_alloc_t *alloc;        /* the variant being benchmarked */
+static int cache_mode = FCACHE_HOT;  /* -c */
+static int flush_heap = 0;       /* -F */
+
+static char tracedir[1024] = TRACEDIR;
+static char *default_tracefiles[] = { DEFAULT_TRACEFILES, NULL };
+
+static void usage(void);
+
+/*
+ * fill_block - Write the bytes that check_block expects
+ */
+static void fill_block(char *p, int index, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+	p[i] = (char)(index * 7 + i);
+}
+
+/*
+ * check_block - Has the payload of block index survived intact?
+ */
+static int check_block(char *p, int index, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+	if (p[i] != (char)(index * 7 + i))
+	    return 0;
+    return 1;
+}
+
+/*
+ * malloc_error - Report an error in the allocator's handling of a trace
+ */
+static void malloc_error(const char *name, int opnum, char *msg)
+{
+    fprintf(stderr, "ERROR [%s, op %d]: %s\n", name, opnum, msg);
+}
+
+/*
+ * eval_mm_valid - Check the allocator for correctness on a trace:
+ *     every payload must be aligned and inside the heap, and keep its
+ *     contents until it is freed or reallocated (which also catches
+ *     overlapping blocks). Returns 1 if the trace passes.
+ */
+static int eval_mm_valid(trace_t *trace, const char *name)
+{
+    char **blocks;
+    int *sizes, i, ok = 0;
+
+    blocks = calloc(trace->num_ids, sizeof(char *));
+    sizes = calloc(trace->num_ids, sizeof(int));
+    mem_reset_brk();
+    if (alloc->init() < 0) {
+	malloc_error(name, 0, "mm_init failed.");
+	goto out;
+    }
+    for (i = 0; i < trace->num_ops; i++) {
+	int index = trace->ops[i].index;
+	int size = trace->ops[i].size;
+	char *p, *old = blocks[index];
+
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	case REALLOC:
+	    if (trace->ops[i].type == REALLOC) {
+		p = alloc->realloc(old, size);
+		if (p && !check_block(p, index, size < sizes[index] ?
+				      size : sizes[index])) {
+		    malloc_error(name, i, "mm_realloc did not preserve the data from old block");
+		    goto out;
+		}
+	    } else {
+		p = alloc->malloc(size);
+	    }
+	    if (p == NULL) {
+		malloc_error(name, i, "mm_malloc/mm_realloc failed.");
+		goto out;
+	    }
+	    if ((size_t)p % ALIGNMENT != 0) {
+		malloc_error(name, i, "Payload address is not aligned.");
+		goto out;
+	    }
+	    if (alloc->memlib && (p < (char *)mem_heap_lo() ||
+				  p + size - 1 > (char *)mem_heap_hi())) {
+		malloc_error(name, i, "Payload lies outside the heap.");
+		goto out;
+	    }
+	    fill_block(p, index, size);
+	    blocks[index] = p;
+	    sizes[index] = size;
+	    break;
+	case FREE:
+	    if (!check_block(old, index, sizes[index])) {
+		malloc_error(name, i, "Payload was overwritten while allocated.");
+		goto out;
+	    }
+	    alloc->free(old);
+	    blocks[index] = NULL;
+	    sizes[index] = 0;
+	    break;
+	}
+    }
+    ok = 1;
+ out:
+    free(blocks);
+    free(sizes);
+    return ok;
+}
+
+/*
+ * eval_mm_util - Peak live payload over the final heap size
+ */
+static double eval_mm_util(trace_t *trace, size_t *heap)
+{
+    char **blocks;
+    int *sizes, i;
+    long live = 0, peak = 0;
+
+    blocks = calloc(trace->num_ids, sizeof(char *));
+    sizes = calloc(trace->num_ids, sizeof(int));
+    mem_reset_brk();
+    alloc->init();
+    for (i = 0; i < trace->num_ops; i++) {
+	int index = trace->ops[i].index;
+	int size = trace->ops[i].size;
+
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    blocks[index] = alloc->malloc(size);
+	    live += size;
+	    sizes[index] = size;
+	    break;
+	case REALLOC:
+	    blocks[index] = alloc->realloc(blocks[index], size);
+	    live += size - sizes[index];
+	    sizes[index] = size;
+	    break;
+	case FREE:
+	    alloc->free(blocks[index]);
+	    live -= sizes[index];
+	    sizes[index] = 0;
+	    break;
+	}
+	if (live > peak)
+	    peak = live;
+    }
+    *heap = mem_heapsize();
+    free(blocks);
+    free(sizes);
+    return *heap ? (double)peak / *heap : 0;
+}
+
+/*
+ * eval_mm_speed - The function fstat times: replay the whole trace
+ */
+static void eval_mm_speed(void *ptr)
+{
+    speed_t *sp = ptr;
+    trace_t *trace = sp->trace;
+    char **blocks = sp->blocks;
+    int i;
+
+    mem_reset_brk();
+    alloc->init();
+    for (i = 0; i < trace->num_ops; i++) {
+	int index = trace->ops[i].index;
+
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    blocks[index] = alloc->malloc(trace->ops[i].size);
+	    break;
+	case REALLOC:
+	    blocks[index] = alloc->realloc(blocks[index], trace->ops[i].size);
+	    break;
+	case FREE:
+	    alloc->free(blocks[index]);
+	    break;
+	}
+    }
+}
+
+/*
+ * prepare_caches - Called by fstat before each trial: evict the caches
+ *     for the -c mode and flush the heap the trial will reuse
+ */
+static void prepare_caches(void *unused)
+{
+    (void)unused;
+    fcache_evict(cache_mode);
+    if (flush_heap && alloc->memlib)
+	fcache_flush(mem_heap_lo(), mem_heap_hi());
+}
+
+/*
+ * check_trace - Correctness and utilization passes of one trace
+ */
+static void check_trace(trace_t *trace, const char *name, stats_t *st)
+{
+    st->ops = trace->num_ops;
+    st->valid = eval_mm_valid(trace, name);
+    if (st->valid) {
+	st->util = eval_mm_util(trace, &st->heap);
+	if (alloc->stats)
+	    alloc->stats(&st->mm);
+    }
+}
+
+/*
+ * now_ns - Monotonic time in ns
+ */
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * eval_mm_latency - Time every call of a replay on its own and return
+ *     the latency percentiles in lat. The cost of reading the clock,
+ *     estimated as the fastest of many empty measurements, is
+ *     subtracted.
+ */
+static void eval_mm_latency(trace_t *trace, double *lat)
+{
+    char **blocks;
+    double *ns, t, overhead = 1e9;
+    int i;
+
+    blocks = calloc(trace->num_ids, sizeof(char *));
+    ns = malloc((trace->num_ops + 1) * sizeof(double));
+    if (blocks == NULL || ns == NULL) {
+	fprintf(stderr, "mbench: out of memory\n");
+	exit(1);
+    }
+    for (i = 0; i < 1000; i++) {
+	t = now_ns();
+	t = now_ns() - t;
+	if (t < overhead)
+	    overhead = t;
+    }
+
+    mem_reset_brk();
+    alloc->init();
+    for (i = 0; i < trace->num_ops; i++) {
+	int index = trace->ops[i].index;
+
+	t = now_ns();
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    blocks[index] = alloc->malloc(trace->ops[i].size);
+	    break;
+	case REALLOC:
+	    blocks[index] = alloc->realloc(blocks[index], trace->ops[i].size);
+	    break;
+	case FREE:
+	    alloc->free(blocks[index]);
+	    break;
+	}
+	t = now_ns() - t - overhead;
+	ns[i] = t < 0 ? 0 : t;
+    }
+
+    qsort(ns, trace->num_ops, sizeof(double), cmp_double);
+    for (i = 0; i < NLAT; i++) {
+	int k = (int)(lat_pct[i] / 100 * trace->num_ops);
+
+	lat[i] = trace->num_ops == 0 ? 0 :
+	    ns[k < trace->num_ops ? k : trace->num_ops - 1];
+    }
+    free(ns);
+    free(blocks);
+}
+
+/*
+ * check_parallel - Run check_trace for all traces in up to jobs worker
+ *     processes at a time
+ */
+static void check_parallel(trace_t **traces, char **names, stats_t *stats,
+			   int num, int jobs)
+{
+    pid_t pids[MAXTRACES];
+    int fds[MAXTRACES];
+    int next = 0, running = 0, i, status;
+    pid_t pid;
+
+    memset(pids, 0, sizeof(pids));
+    while (next < num || running > 0) {
+	if (next < num && running < jobs) {
+	    int fd[2];
+
+	    if (pipe(fd) < 0 || (pids[next] = fork()) < 0) {
+		perror("mbench: fork");
+		exit(1);
+	    }
+	    if (pids[next] == 0) {           /* worker */
+		stats_t st;
+
+		close(fd[0]);
+		memset(&st, 0, sizeof(st));
+		check_trace(traces[next], names[next], &st);
+		if (write(fd[1], &st, sizeof(st)) != sizeof(st))
+		    _exit(1);
+		_exit(0);
+	    }
+	    close(fd[1]);
+	    fds[next++] = fd[0];
+	    running++;
+	    continue;
+	}
+
+	/* collect one finished worker */
+	pid = wait(&status);
+	for (i = 0; i < num; i++) {
+	    if (pids[i] == pid) {
+		if (read(fds[i], &stats[i], sizeof(stats_t)) != sizeof(stats_t)) {
+		    fprintf(stderr, "mbench: worker for %s died\n", names[i]);
+		    stats[i].ops = traces[i]->num_ops;
+		    stats[i].valid = 0;
+		}
+		close(fds[i]);
+		running--;
+		break;
+	    }
+	}
+    }
+}
+
+/*
+ * basename_of - The file name part of a trace path
+ */
+static const char *basename_of(const char *path)
+{
+    return strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+}
+
+/*
+ * printresults - Print the performance table, like the driver
+ */
+static void printresults(int n, char **names, stats_t *stats, int timed)
+{
+    double secs = 0, ops = 0, util = 0;
+    int i, valid = 1;
+
+    printf("%5s %-24s %5s %6s %10s %10s %6s %8s\n",
+	   "trace", "name", "valid", "util", "ops", "secs", "+/-", "Kops");
+    for (i = 0; i < n; i++) {
+	const char *base = basename_of(names[i]);
+
+	if (stats[i].valid) {
+	    if (alloc->memlib)
+		printf("%5d %-24s %5s %5.0f%% %10.0f", i, base, "yes",
+		       stats[i].util * 100.0, stats[i].ops);
+	    else
+		printf("%5d %-24s %5s %6s %10.0f", i, base, "yes", "-",
+		       stats[i].ops);
+	    if (timed)
+		printf(" %10.6f %5.1f%% %8.0f\n", stats[i].secs,
+		       50.0 * (stats[i].hi - stats[i].lo) / stats[i].secs,
+		       stats[i].ops / 1e3 / stats[i].secs);
+	    else
+		printf(" %10s %6s %8s\n", "-", "-", "-");
+	    secs += stats[i].secs;
+	    ops += stats[i].ops;
+	    util += stats[i].util;
+	} else {
+	    printf("%5d %-24s %5s %6s %10s %10s %6s %8s\n", i, base, "no",
+		   "-", "-", "-", "-", "-");
+	    valid = 0;
+	}
+    }
+    if (valid && n > 0) {
+	if (alloc->memlib)
+	    printf("%5s %-24s %5s %5.0f%% %10.0f", "Total", "", "",
+		   util / n * 100.0, ops);
+	else
+	    printf("%5s %-24s %5s %6s %10.0f", "Total", "", "", "-", ops);
+	if (timed)
+	    printf(" %10.6f %6s %8.0f\n", secs, "", ops / 1e3 / secs);
+	else
+	    printf(" %10s %6s %8s\n", "-", "-", "-");
+    }
+}
+
+/*
+ * compare_results - Compare the timings against the samples saved in
+ *     file by another build. Returns 1 if any trace got significantly
+ *     slower.
+ */
+static int compare_results(const char *file, int n, char **names,
+			   fstat_t *times)
+{
+    char name[256];
+    fstat_t base;
+    fstat_diff_t diff;
+    FILE *fp;
+    int i, found, slower = 0;
+
+    if ((fp = fopen(file, "r")) == NULL) {
+	perror(file);
+	exit(1);
+    }
+    printf("\nCompared with %s:\n", file);
+    printf("%-24s %10s %10s %8s %18s  %s\n", "name", "base", "secs",
+	   "ratio", "interval", "verdict");
+    for (i = 0; i < n; i++) {
+	if (times[i].n == 0)
+	    continue;
+	rewind(fp);
+	found = 0;
+	while (!found && fstat_read(fp, name, sizeof(name), &base)) {
+	    if (strcmp(name, basename_of(names[i])) == 0)
+		found = 1;
+	    else
+		fstat_free(&base);
+	}
+	if (!found) {
+	    printf("%-24s %10s\n", basename_of(names[i]), "-");
+	    continue;
+	}
+	fstat_compare(&base, &times[i], &diff);
+	printf("%-24s %10.6f %10.6f %7.3fx  [%6.3f, %6.3f]  %s\n",
+	       basename_of(names[i]), base.median, times[i].median,
+	       diff.ratio, diff.lo, diff.hi,
+	       diff.verdict > 0 ? "SLOWER" : diff.verdict < 0 ? "faster" :
+	       "no significant change");
+	if (diff.verdict > 0)
+	    slower = 1;
+	fstat_free(&base);
+    }
+    fclose(fp);
+    return slower;
+}
+
+/*
+ * rss_bytes - Resident set size of this process, from /proc/self/statm
+ */
+static long rss_bytes(void)
+{
+    long size, resident = 0;
+    FILE *fp;
+
+    if ((fp = fopen("/proc/self/statm", "r")) == NULL)
+	return 0;
+    if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+	resident = 0;
+    fclose(fp);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+/*
+ * series_header - The column names of the -T time series
+ */
+static void series_header(FILE *fp)
+{
+    int k;
+
+    fprintf(fp, "trace,op,live,heap,bytes_free,largest_free,extend_heap,rss");
+    for (k = 0; k < MM_NUM_CLASSES; k++)
+	fprintf(fp, ",free_%lu", 16UL << k);
+    fprintf(fp, "\n");
+}
+
+/*
+ * eval_mm_series - Replay a trace, writing a row of heap footprint
+ *     data to fp every ops and after the last op
+ */
+static void eval_mm_series(trace_t *trace, const char *name, FILE *fp,
+			   int every)
+{
+    char **blocks;
+    int *sizes, i, k;
+    long live = 0;
+    mm_stats_t mm;
+
+    blocks = calloc(trace->num_ids, sizeof(char *));
+    sizes = calloc(trace->num_ids, sizeof(int));
+    mem_reset_brk();
+    alloc->init();
+    for (i = 0; i < trace->num_ops; i++) {
+	int index = trace->ops[i].index;
+	int size = trace->ops[i].size;
+
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    blocks[index] = alloc->malloc(size);
+	    live += size;
+	    sizes[index] = size;
+	    break;
+	case REALLOC:
+	    blocks[index] = alloc->realloc(blocks[index], size);
+	    live += size - sizes[index];
+	    sizes[index] = size;
+	    break;
+	case FREE:
+	    alloc->free(blocks[index]);
+	    live -= sizes[index];
+	    sizes[index] = 0;
+	    break;
+	}
+	if ((i + 1) % every != 0 && i != trace->num_ops - 1)
+	    continue;
+	memset(&mm, 0, sizeof(mm));
+	if (alloc->stats)
+	    alloc->stats(&mm);
+	else
+	    mm.heap_size = mem_heapsize();
+	fprintf(fp, "%s,%d,%ld,%lu,%lu,%lu,%lu,%ld", name, i + 1, live,
+		(unsigned long)mm.heap_size, (unsigned long)mm.bytes_free,
+		(unsigned long)mm.largest_free,
+		(unsigned long)mm.extend_heap_calls, rss_bytes());
+	for (k = 0; k < MM_NUM_CLASSES; k++)
+	    fprintf(fp, ",%lu", (unsigned long)mm.free_bytes[k]);
+	fprintf(fp, "\n");
+    }
+    free(blocks);
+    free(sizes);
+}
+
+/*
+ * cpu_model - The "model name" line of /proc/cpuinfo, or "unknown"
+ */
+static void cpu_model(char *buf, int len)
+{
+    char line[256], *p;
+    FILE *fp;
+
+    snprintf(buf, len, "unknown");
+    if ((fp = fopen("/proc/cpuinfo", "r")) == NULL)
+	return;
+    while (fgets(line, sizeof(line), fp)) {
+	if (strncmp(line, "model name", 10) == 0 && (p = strchr(line, ':'))) {
+	    p += strspn(p + 1, " \t") + 1;
+	    p[strcspn(p, "\n")] = '\0';
+	    snprintf(buf, len, "%s", p);
+	    break;
+	}
+    }
+    fclose(fp);
+}
+
+/*
+ * json_str - Print s as a JSON string
+ */
+static void json_str(FILE *fp, const char *s)
+{
+    putc('"', fp);
+    for (; *s; s++) {
+	if (*s == '"' || *s == '\\')
+	    putc('\\', fp);
+	if ((unsigned char)*s >= ' ')
+	    putc(*s, fp);
+    }
+    putc('"', fp);
+}
+
+/* The run-level metadata written at the top of a result file */
+typedef struct {
+    const char *key;
+    char value[256];
+} meta_t;
+
+#define NMETA 9
+
+/*
+ * get_meta - Fill in the build and host metadata of this run
+ */
+static void get_meta(meta_t *meta)
+{
+    struct utsname u;
+    time_t t = time(NULL);
+    int i = 0;
+
+    uname(&u);
+    meta[i].key = "build";
+    snprintf(meta[i++].value, sizeof(meta->value), "%s", BUILD_ID);
+    meta[i].key = "cflags";
+    snprintf(meta[i++].value, sizeof(meta->value), "%s", BUILD_CFLAGS);
+    meta[i].key = "compiler";
+#ifdef __VERSION__
+    snprintf(meta[i++].value, sizeof(meta->value), "%s", __VERSION__);
+#else
+    snprintf(meta[i++].value, sizeof(meta->value), "unknown");
+#endif
+    meta[i].key = "host";
+    snprintf(meta[i++].value, sizeof(meta->value), "%s", u.nodename);
+    meta[i].key = "kernel";
+    snprintf(meta[i++].value, sizeof(meta->value), "%s %s %s", u.sysname,
+	     u.release, u.machine);
+    meta[i].key = "cpu";
+    cpu_model(meta[i++].value, sizeof(meta->value));
+    meta[i].key = "cpus";
+    snprintf(meta[i++].value, sizeof(meta->value), "%ld",
+	     sysconf(_SC_NPROCESSORS_ONLN));
+    meta[i].key = "cache";
+    snprintf(meta[i++].value, sizeof(meta->value), "%s%s",
+	     fcache_name(cache_mode), flush_heap ? "+flush" : "");
+    meta[i].key = "date";
+    strftime(meta[i++].value, sizeof(meta->value), "%Y-%m-%dT%H:%M:%SZ",
+	     gmtime(&t));
+}
+
+/*
+ * write_csv - One row per trace; the metadata goes in leading
+ *     "# key: value" comment lines
+ */
+static void write_csv(FILE *fp, meta_t *meta, int n, char **names,
+		      stats_t *stats, fstat_t *times)
+{
+    int i, k;
+
+    for (i = 0; i < NMETA; i++)
+	fprintf(fp, "# %s: %s\n", meta[i].key, meta[i].value);
+    fprintf(fp, "trace,valid,ops,util,heap,secs,secs_lo,secs_hi,secs_mad,"
+	    "trials,outliers,kops");
+    for (k = 0; k < NLAT; k++)
+	fprintf(fp, ",lat_%s_ns", lat_name[k]);
+    fprintf(fp, ",extend_heap,splits,coalesces,realloc_inplace,realloc_copy");
+    for (k = 0; k < FPERF_NEVENTS; k++)
+	fprintf(fp, ",%s", fperf_name(k));
+    fprintf(fp, "\n");
+
+    for (i = 0; i < n; i++) {
+	stats_t *st = &stats[i];
+
+	fprintf(fp, "%s,%d,%.0f,%.6f,%lu,%.9g,%.9g,%.9g,%.9g,%d,%d,%.3f",
+		basename_of(names[i]), st->valid, st->ops, st->util,
+		(unsigned long)st->heap, st->secs, st->lo, st->hi,
+		times[i].mad, times[i].n, times[i].outliers,
+		st->secs > 0 ? st->ops / 1e3 / st->secs : 0);
+	for (k = 0; k < NLAT; k++)
+	    fprintf(fp, ",%.0f", st->lat[k]);
+	fprintf(fp, ",%lu,%lu,%lu,%lu,%lu",
+		(unsigned long)st->mm.extend_heap_calls,
+		(unsigned long)st->mm.splits, (unsigned long)st->mm.coalesces,
+		(unsigned long)st->mm.realloc_inplace,
+		(unsigned long)st->mm.realloc_copy);
+	for (k = 0; k < FPERF_NEVENTS; k++) {
+	    if (st->perf.valid[k])
+		fprintf(fp, ",%.0f", st->perf.count[k]);
+	    else
+		fprintf(fp, ",");
+	}
+	fprintf(fp, "\n");
+    }
+}
+
+/*
+ * write_json - The same data as one JSON object
+ */
+static void write_json(FILE *fp, meta_t *meta, int n, char **names,
+		       stats_t *stats, fstat_t *times)
+{
+    double ops = 0, secs = 0, util = 0;
+    int i, k, valid = 0;
+
+    fprintf(fp, "{\n");
+    for (i = 0; i < NMETA; i++) {
+	fprintf(fp, "  \"%s\": ", meta[i].key);
+	json_str(fp, meta[i].value);
+	fprintf(fp, ",\n");
+    }
+    fprintf(fp, "  \"traces\": [");
+    for (i = 0; i < n; i++) {
+	stats_t *st = &stats[i];
+
+	fprintf(fp, "%s\n    {\"trace\": ", i ? "," : "");
+	json_str(fp, basename_of(names[i]));
+	fprintf(fp, ", \"valid\": %s, \"ops\": %.0f", st->valid ? "true" : "false",
+		st->ops);
+	if (!st->valid) {
+	    fprintf(fp, "}");
+	    continue;
+	}
+	valid++;
+	ops += st->ops;
+	secs += st->secs;
+	util += st->util;
+	fprintf(fp, ",\n     \"util\": %.6f, \"heap\": %lu", st->util,
+		(unsigned long)st->heap);
+	fprintf(fp, ",\n     \"secs\": {\"median\": %.9g, \"lo\": %.9g, "
+		"\"hi\": %.9g, \"mad\": %.9g, \"trials\": %d, \"outliers\": %d}",
+		st->secs, st->lo, st->hi, times[i].mad, times[i].n,
+		times[i].outliers);
+	fprintf(fp, ",\n     \"kops\": %.3f",
+		st->secs > 0 ? st->ops / 1e3 / st->secs : 0);
+	fprintf(fp, ",\n     \"latency_ns\": {");
+	for (k = 0; k < NLAT; k++)
+	    fprintf(fp, "%s\"%s\": %.0f", k ? ", " : "", lat_name[k], st->lat[k]);
+	fprintf(fp, "}");
+	fprintf(fp, ",\n     \"mm\": {\"extend_heap\": %lu, \"splits\": %lu, "
+		"\"coalesces\": %lu, \"realloc_inplace\": %lu, "
+		"\"realloc_copy\": %lu}",
+		(unsigned long)st->mm.extend_heap_calls,
+		(unsigned long)st->mm.splits, (unsigned long)st->mm.coalesces,
+		(unsigned long)st->mm.realloc_inplace,
+		(unsigned long)st->mm.realloc_copy);
+	fprintf(fp, ",\n     \"perf\": {");
+	for (k = 0; k < FPERF_NEVENTS; k++) {
+	    fprintf(fp, "%s\"%s\": ", k ? ", " : "", fperf_name(k));
+	    if (st->perf.valid[k])
+		fprintf(fp, "%.0f", st->perf.count[k]);
+	    else
+		fprintf(fp, "null");
+	}
+	fprintf(fp, "}}");
+    }
+    fprintf(fp, "\n  ],\n  \"total\": {\"traces\": %d, \"valid\": %d, "
+	    "\"ops\": %.0f, \"secs\": %.9g, \"kops\": %.3f, \"util\": %.6f}\n}\n",
+	    n, valid, ops, secs, secs > 0 ? ops / 1e3 / secs : 0,
+	    valid ? util / valid : 0);
+}
+
+/*
+ * write_results - Write the run to file, as JSON if its name ends in
+ *     .json and as CSV otherwise
+ */
+static void write_results(const char *file, int n, char **names,
+			  stats_t *stats, fstat_t *times)
+{
+    meta_t meta[NMETA];
+    const char *ext = strrchr(file, '.');
+    FILE *fp;
+
+    if ((fp = fopen(file, "w")) == NULL) {
+	perror(file);
+	exit(1);
+    }
+    get_meta(meta);
+    if (ext && strcmp(ext, ".json") == 0)
+	write_json(fp, meta, n, names, stats, times);
+    else
+	write_csv(fp, meta, n, names, stats, times);
+    fclose(fp);
+}
+
+/*
+ * run_suite - Check and time all traces with the current variant. With
+ *     detail set, also measure the latencies and, if perf_events is
+ *     nonzero, the hardware counters.
+ */
+static void run_suite(trace_t **traces, char **names, int n, stats_t *stats,
+		      fstat_t *times, int jobs, int timed, int detail,
+		      int perf_events)
+{
+    int i;
+
+    /* correctness and utilization: in parallel if asked to */
+    if (jobs > 1) {
+	check_parallel(traces, names, stats, n, jobs);
+    } else {
+	for (i = 0; i < n; i++)
+	    check_trace(traces[i], names[i], &stats[i]);
+    }
+    if (!timed)
+	return;
+
+    /* throughput: always serialised */
+    for (i = 0; i < n; i++) {
+	speed_t speed;
+
+	if (!stats[i].valid)
+	    continue;
+	speed.trace = traces[i];
+	speed.blocks = calloc(traces[i]->num_ids, sizeof(char *));
+	if (verbose)
+	    printf("Timing %s with %s\n", names[i], alloc->name);
+	if (fstat(eval_mm_speed, &speed, &times[i]) < 0) {
+	    fprintf(stderr, "mbench: out of memory\n");
+	    exit(1);
+	}
+	stats[i].secs = times[i].median;
+	stats[i].lo = times[i].lo;
+	stats[i].hi = times[i].hi;
+	if (detail) {
+	    eval_mm_latency(traces[i], stats[i].lat);
+	    if (perf_events > 0)
+		fperf(eval_mm_speed, &speed, &stats[i].perf);
+	}
+	free(speed.blocks);
+    }
+}
+
+/*
+ * printcomparison - One row per trace, utilization and throughput of
+ *     every variant side by side
+ */
+static void printcomparison(int na, mm_alloc_t **allocs, int n, char **names,
+			    stats_t (*stats)[MAXTRACES], int timed)
+{
+    int a, i;
+
+    printf("\nComparison (util, Kops):\n%-24s", "trace");
+    for (a = 0; a < na; a++)
+	printf(" %17s", allocs[a]->name);
+    printf("\n");
+    for (i = 0; i < n; i++) {
+	printf("%-24s", basename_of(names[i]));
+	for (a = 0; a < na; a++) {
+	    stats_t *st = &stats[a][i];
+
+	    if (!st->valid)
+		printf(" %17s", "invalid");
+	    else if (allocs[a]->memlib)
+		printf("   %5.1f%%", 100.0 * st->util);
+	    else
+		printf("   %6s", "-");
+	    if (st->valid && timed)
+		printf(" %8.0f", st->ops / 1e3 / st->secs);
+	    else if (st->valid)
+		printf(" %8s", "-");
+	}
+	printf("\n");
+    }
+    printf("%-24s", "Total");
+    for (a = 0; a < na; a++) {
+	double ops = 0, secs = 0, util = 0;
+	int valid = 0;
+
+	for (i = 0; i < n; i++) {
+	    if (!stats[a][i].valid)
+		continue;
+	    ops += stats[a][i].ops;
+	    secs += stats[a][i].secs;
+	    util += stats[a][i].util;
+	    valid++;
+	}
+	if (valid && allocs[a]->memlib)
+	    printf("   %5.1f%%", 100.0 * util / valid);
+	else
+	    printf("   %6s", "-");
+	if (timed && secs > 0)
+	    printf(" %8.0f", ops / 1e3 / secs);
+	else
+	    printf(" %8s", "-");
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    char *tracefiles[MAXTRACES];
+    trace_t *traces[MAXTRACES];
+    static stats_t stats[MAXALLOCS][MAXTRACES];
+    static fstat_t times[MAXALLOCS][MAXTRACES];
+    mm_alloc_t *allocs[MAXALLOCS];
+    char *savefile = NULL, *basefile = NULL, *resultfile = NULL;
+    char *seriesfile = NULL;
+    int num_tracefiles = 0, jobs = 1, timed = 1, slower = 0, perf_events = 0;
+    int num_allocs = 0, every = 1000, a, c, i;
+
+    while ((c = getopt(argc, argv, "hvsFAa:f:t:j:P:n:w:c:o:C:r:T:N:")) != EOF) {
+	switch (c) {
+	case 'a':
+	    if (num_allocs == MAXALLOCS) {
+		fprintf(stderr, "mbench: too many allocators\n");
+		exit(1);
+	    }
+	    if ((allocs[num_allocs++] = mm_find_allocator(optarg)) == NULL) {
+		fprintf(stderr, "mbench: unknown allocator %s\n", optarg);
+		usage();
+		exit(1);
+	    }
+	    break;
+	case 'A':
+	    for (num_allocs = 0; mm_allocators[num_allocs] != NULL &&
+		     num_allocs < MAXALLOCS; num_allocs++)
+		allocs[num_allocs] = mm_allocators[num_allocs];
+	    break;
+	case 'f':
+	    if (num_tracefiles == MAXTRACES) {
+		fprintf(stderr, "mbench: too many traces\n");
+		exit(1);
+	    }
+	    tracefiles[num_tracefiles++] = optarg;
+	    strcpy(tracedir, "");
+	    break;
+	case 't':
+	    strncpy(tracedir, optarg, sizeof(tracedir) - 2);
+	    if (tracedir[strlen(tracedir) - 1] != '/')
+		strcat(tracedir, "/");
+	    break;
+	case 'j':
+	    jobs = atoi(optarg);
+	    break;
+	case 'P':
+	    set_fstat_cpu(atoi(optarg));
+	    break;
+	case 'n':
+	    set_fstat_trials(atoi(optarg));
+	    break;
+	case 'w':
+	    set_fstat_warmup(atoi(optarg));
+	    break;
+	case 'c':
+	    if ((cache_mode = fcache_mode(optarg)) < 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case 'F':
+	    flush_heap = 1;
+	    break;
+	case 'o':
+	    savefile = optarg;
+	    break;
+	case 'C':
+	    basefile = optarg;
+	    break;
+	case 'r':
+	    resultfile = optarg;
+	    break;
+	case 'T':
+	    seriesfile = optarg;
+	    break;
+	case 'N':
+	    every = atoi(optarg);
+	    break;
+	case 's':
+	    timed = 0;
+	    break;
+	case 'v':
+	    verbose = 1;
+	    break;
+	case 'h':
+	default:
+	    usage();
+	    exit(c == 'h' ? 0 : 1);
+	}
+    }
+    if (every <= 0) {
+	usage();
+	exit(1);
+    }
+    if (jobs <= 0)
+	jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_tracefiles == 0) {
+	for (i = 0; default_tracefiles[i] != NULL; i++)
+	    tracefiles[num_tracefiles++] = default_tracefiles[i];
+    }
+
+    for (i = 0; i < num_tracefiles; i++) {
+	if (verbose)
+	    printf("Reading tracefile: %s%s\n", tracedir, tracefiles[i]);
+	if ((traces[i] = read_trace(tracedir, tracefiles[i])) == NULL)
+	    exit(1);
+    }
+    if (num_allocs == 0)
+	allocs[num_allocs++] = mm_allocators[0];
+    mem_init();
+
+    if (timed) {
+	init_fcache();
+	if (resultfile)
+	    perf_events = init_fperf();
+	if (cache_mode != FCACHE_HOT || flush_heap) {
+	    set_fstat_prepare(prepare_caches, NULL);
+	    printf("Cache state: %s", fcache_name(cache_mode));
+	    if (cache_mode != FCACHE_HOT)
+		printf(" (evicting %ld KB, %d byte lines)",
+		       2 * fcache_size(cache_mode) >> 10, fcache_line());
+	    if (flush_heap)
+		printf(", heap flushed");
+	    printf("\n");
+	}
+    }
+
+    for (a = 0; a < num_allocs; a++) {
+	alloc = allocs[a];
+	run_suite(traces, tracefiles, num_tracefiles, stats[a], times[a], jobs,
+		  timed, a == 0 && resultfile != NULL, perf_events);
+	if (num_allocs > 1)
+	    printf("%sAllocator %s: %s\n", a ? "\n" : "", alloc->name,
+		   alloc->description);
+	printresults(num_tracefiles, tracefiles, stats[a], timed);
+	if (a > 0)
+	    continue;
+
+	/* the single-variant outputs describe the first variant */
+	if (seriesfile) {
+	    FILE *fp = fopen(seriesfile, "w");
+
+	    if (fp == NULL) {
+		perror(seriesfile);
+		exit(1);
+	    }
+	    series_header(fp);
+	    for (i = 0; i < num_tracefiles; i++)
+		if (stats[a][i].valid)
+		    eval_mm_series(traces[i], basename_of(tracefiles[i]), fp,
+				   every);
+	    fclose(fp);
+	}
+	if (resultfile)
+	    write_results(resultfile, num_tracefiles, tracefiles, stats[a],
+			  times[a]);
+	if (timed && savefile) {
+	    FILE *fp = fopen(savefile, "w");
+
+	    if (fp == NULL) {
+		perror(savefile);
+		exit(1);
+	    }
+	    for (i = 0; i < num_tracefiles; i++)
+		if (times[a][i].n > 0)
+		    fstat_write(fp, basename_of(tracefiles[i]), &times[a][i]);
+	    fclose(fp);
+	}
+	if (timed && basefile)
+	    slower = compare_results(basefile, num_tracefiles, tracefiles,
+				     times[a]);
+    }
+    if (num_allocs > 1)
+	printcomparison(num_allocs, allocs, num_tracefiles, tracefiles, stats,
+			timed);
+
+    if (perf_events > 0)
+	deinit_fperf();
+    for (i = 0; i < num_tracefiles; i++) {
+	for (a = 0; a < num_allocs; a++)
+	    fstat_free(&times[a][i]);
+	free_trace(traces[i]);
+    }
+    mem_deinit();
+    return slower ? 2 : 0;
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    int i;
+
+    fprintf(stderr, "Usage: mbench [-hvsFA] [-a <alloc>]... [-j <jobs>] [-P <cpu>]\n");
+    fprintf(stderr, "              [-n <trials>] [-w <warmup>] [-c <cache>] [-o <file>]\n");
+    fprintf(stderr, "              [-C <file>] [-r <file>] [-T <file> [-N <ops>]]\n");
+    fprintf(stderr, "              [-t <dir>] [-f <file>]...\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-a <alloc> Benchmark this allocator (may be repeated):");
+    for (i = 0; mm_allocators[i] != NULL; i++)
+	fprintf(stderr, " %s", mm_allocators[i]->name);
+    fprintf(stderr, ".\n");
+    fprintf(stderr, "\t-A         Benchmark all the allocators.\n");
+    fprintf(stderr, "\t-c <cache> Start each trial hot, l2 (L1/L2 cold) or llc (all cold).\n");
+    fprintf(stderr, "\t-C <file>  Compare the timings with samples saved by -o.\n");
+    fprintf(stderr, "\t-f <file>  Use <file> as a trace file (may be repeated).\n");
+    fprintf(stderr, "\t-F         Flush the heap from the caches before each trial.\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-j <jobs>  Check traces in <jobs> parallel workers (0 = one per CPU).\n");
+    fprintf(stderr, "\t-n <n>     Timed trials per trace (default 15).\n");
+    fprintf(stderr, "\t-N <ops>   Ops between two rows of the -T series (default 1000).\n");
+    fprintf(stderr, "\t-o <file>  Save the timing samples to <file>.\n");
+    fprintf(stderr, "\t-P <cpu>   Pin the timing passes to <cpu>.\n");
+    fprintf(stderr, "\t-r <file>  Write all results to <file> (.json: JSON, else CSV).\n");
+    fprintf(stderr, "\t-s         Skip the timing passes.\n");
+    fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T <file>  Write the heap footprint over each replay to <file> (CSV).\n");
+    fprintf(stderr, "\t-v         Print progress information.\n");
+    fprintf(stderr, "\t-w <n>     Untimed warm-up runs per trace (default 2).\n");
+}
@@ -0,0 +1,230 @@
+/*
+ * mcompare.c - Diff two mbench result files and flag regressions
+ *
+ * Both files are CSV results written by mbench -r. Traces are matched
+ * by name. For each trace mcompare reports the change in throughput
+ * time, utilization and p99 latency, and flags:
+ *
+ *   - a time regression when the median time grew by more than -t
+ *     percent AND the confidence intervals recorded in the two files
+ *     do not overlap, so a change within the noise of either run is
+ *     reported as "noise" rather than as a regression;
+ *   - a utilization regression when utilization dropped by more than
+ *     -u percentage points (utilization is deterministic);
+ *   - a latency regression when the p99 latency grew by more than -l
+ *     percent.
+ *
+ * The exit status is 1 if any regression was flagged, so that a script
+ * can keep a history of result files and stop on the first slowdown.
+ *
+ * usage: mcompare [-h] [-t <pct>] [-u <points>] [-l <pct>] <base.csv> <new.csv>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#define MAXLINE 4096
+#define MAXFIELDS 64
+#define MAXROWS 256
+
+/* The metrics of one trace that mcompare looks at */
+typedef struct {
+    char trace[256];
+    int valid;
+    double util, secs, lo, hi, p99;
+} row_t;
+
+/* The columns those metrics come from, by header name */
+static const char *columns[] = {
+    "trace", "valid", "util", "secs", "secs_lo", "secs_hi", "lat_p99_ns"
+};
+#define NCOLUMNS 7
+
+static double time_pct = 3.0;     /* -t */
+static double util_points = 1.0;  /* -u */
+static double lat_pct = 10.0;     /* -l */
+
+static void usage(void);
+
+/*
+ * split - Split a CSV line in place into at most MAXFIELDS fields
+ */
+static int split(char *line, char **fields)
+{
+    int n = 0;
+
+    line[strcspn(line, "\r\n")] = '\0';
+    fields[n++] = line;
+    for (; *line && n < MAXFIELDS; line++) {
+	if (*line == ',') {
+	    *line = '\0';
+	    fields[n++] = line + 1;
+	}
+    }
+    return n;
+}
+
+/*
+ * read_results - Read the rows of a result file; returns their number,
+ *     or -1 if the file cannot be read or lacks a column
+ */
+static int read_results(const char *file, row_t *rows)
+{
+    char line[MAXLINE], *fields[MAXFIELDS];
+    int col[NCOLUMNS], n = 0, nf, i, j;
+    FILE *fp;
+
+    if ((fp = fopen(file, "r")) == NULL) {
+	perror(file);
+	return -1;
+    }
+    do {
+	if (fgets(line, sizeof(line), fp) == NULL) {
+	    fprintf(stderr, "%s: no header\n", file);
+	    fclose(fp);
+	    return -1;
+	}
+    } while (line[0] == '#');
+
+    nf = split(line, fields);
+    for (j = 0; j < NCOLUMNS; j++) {
+	for (col[j] = -1, i = 0; i < nf; i++)
+	    if (strcmp(fields[i], columns[j]) == 0)
+		col[j] = i;
+	if (col[j] < 0) {
+	    fprintf(stderr, "%s: no %s column\n", file, columns[j]);
+	    fclose(fp);
+	    return -1;
+	}
+    }
+
+    while (n < MAXROWS && fgets(line, sizeof(line), fp) != NULL) {
+	row_t *r = &rows[n];
+
+	if (line[0] == '#' || split(line, fields) < nf)
+	    continue;
+	snprintf(r->trace, sizeof(r->trace), "%s", fields[col[0]]);
+	r->valid = atoi(fields[col[1]]);
+	r->util = atof(fields[col[2]]);
+	r->secs = atof(fields[col[3]]);
+	r->lo = atof(fields[col[4]]);
+	r->hi = atof(fields[col[5]]);
+	r->p99 = atof(fields[col[6]]);
+	n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+/*
+ * pct - Relative change from a to b in percent
+ */
+static double pct(double a, double b)
+{
+    return a > 0 ? 100.0 * (b - a) / a : 0;
+}
+
+/*
+ * compare - Print and flag the changes of one trace; returns the number
+ *     of regressions
+ */
+static int compare(row_t *a, row_t *b)
+{
+    double dt = pct(a->secs, b->secs), du = 100.0 * (b->util - a->util);
+    double dl = pct(a->p99, b->p99);
+    const char *tflag = "", *uflag = "", *lflag = "";
+    int bad = 0;
+
+    if (!a->valid || !b->valid) {
+	printf("%-24s %s\n", a->trace, b->valid ? "invalid in base" :
+	       "INVALID");
+	return !b->valid;
+    }
+    if (dt > time_pct) {
+	if (b->lo > a->hi) {
+	    tflag = " REGRESSION";
+	    bad++;
+	} else {
+	    tflag = " noise";
+	}
+    } else if (dt < -time_pct && b->hi < a->lo) {
+	tflag = " faster";
+    }
+    if (du < -util_points) {
+	uflag = " REGRESSION";
+	bad++;
+    }
+    if (dl > lat_pct) {
+	lflag = " REGRESSION";
+	bad++;
+    }
+
+    printf("%-24s time %10.6f -> %10.6f %+6.1f%%%s\n", a->trace, a->secs,
+	   b->secs, dt, tflag);
+    printf("%-24s util %9.1f%% -> %9.1f%% %+6.1f%s\n", "", 100.0 * a->util,
+	   100.0 * b->util, du, uflag);
+    printf("%-24s p99  %8.0fns -> %8.0fns %+6.1f%%%s\n", "", a->p99, b->p99,
+	   dl, lflag);
+    return bad;
+}
+
+int main(int argc, char **argv)
+{
+    static row_t base[MAXROWS], cur[MAXROWS];
+    int nbase, ncur, i, j, c, bad = 0;
+
+    while ((c = getopt(argc, argv, "ht:u:l:")) != EOF) {
+	switch (c) {
+	case 't':
+	    time_pct = atof(optarg);
+	    break;
+	case 'u':
+	    util_points = atof(optarg);
+	    break;
+	case 'l':
+	    lat_pct = atof(optarg);
+	    break;
+	case 'h':
+	default:
+	    usage();
+	    exit(c == 'h' ? 0 : 2);
+	}
+    }
+    if (argc - optind != 2) {
+	usage();
+	exit(2);
+    }
+    if ((nbase = read_results(argv[optind], base)) < 0 ||
+	(ncur = read_results(argv[optind + 1], cur)) < 0)
+	exit(2);
+
+    for (i = 0; i < nbase; i++) {
+	for (j = 0; j < ncur; j++)
+	    if (strcmp(base[i].trace, cur[j].trace) == 0)
+		break;
+	if (j == ncur) {
+	    printf("%-24s missing\n", base[i].trace);
+	    continue;
+	}
+	bad += compare(&base[i], &cur[j]);
+    }
+    printf("%d regression%s (time > %.1f%% outside noise, util > %.1f points,"
+	   " p99 > %.1f%%)\n", bad, bad == 1 ? "" : "s", time_pct, util_points,
+	   lat_pct);
+    return bad ? 1 : 0;
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mcompare [-h] [-t <pct>] [-u <points>] [-l <pct>] <base.csv> <new.csv>\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h           Print this message.\n");
+    fprintf(stderr, "\t-l <pct>     p99 latency regression threshold (default 10).\n");
+    fprintf(stderr, "\t-t <pct>     Time regression threshold (default 3).\n");
+    fprintf(stderr, "\t-u <points>  Utilization regression threshold (default 1).\n");
+}
@@ -18,20 +18,34 @@
 static char *mem_start_brk;  /* points to first byte of heap */
 static char *mem_brk;        /* points to last byte of heap */
 static char *mem_max_addr;   /* largest legal heap address */ 
+static char *mem_zero_brk;   /* highest brk so far: the storage above is zero */
 
 /* 
- * mem_init - initialize the memory system model
+ * mem_init - initialize the memory system model. Built with MEM_MMAP
+ *    (the LD_PRELOAD shim), the heap is address space reserved with
+ *    mmap instead of malloc'd storage: malloc is then the allocator
+ *    itself, and untouched pages of the heap cost no memory.
  */
 void mem_init(void)
 {
     /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
+#ifdef MEM_MMAP
+    mem_start_brk = mmap(NULL, MAX_HEAP, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem_start_brk == MAP_FAILED) {
+        fprintf(stderr, "mem_init_vm: mmap error\n");
+        exit(1);
+    }
+#else
+    if ((mem_start_brk = (char *)calloc(1, MAX_HEAP)) == NULL) {
         fprintf(stderr, "mem_init_vm: malloc error\n");
         exit(1);
     }
+#endif
 
     mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
     mem_brk = mem_start_brk;                  /* heap is empty initially */
+    mem_zero_brk = mem_start_brk;
 }
 
 /* 
@@ -39,7 +53,11 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
+#ifdef MEM_MMAP
+    munmap(mem_start_brk, MAX_HEAP);
+#else
     free(mem_start_brk);
+#endif
 }
 
 /*
@@ -65,6 +83,8 @@ void *mem_sbrk(int incr)
         return (void *)-1;
     }
     mem_brk += incr;
+    if (mem_brk > mem_zero_brk)
+        mem_zero_brk = mem_brk;
     return (void *)old_brk;
 }
 
@@ -84,6 +104,16 @@ void *mem_heap_hi()
     return (void *)(mem_brk - 1);
 }
 
+/*
+ * mem_heap_zero - return the first byte of storage that has never been
+ *    part of the heap: everything from there on is still zero, which
+ *    mem_reset_brk does not change
+ */
+void *mem_heap_zero()
+{
+    return (void *)mem_zero_brk;
+}
+
 /*
  * mem_heapsize() - returns the heap size in bytes
  */
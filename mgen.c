@@ -0,0 +1,482 @@
+/*
+ * mgen.c - Generate synthetic .rep traces
+ *
+ * Workloads (-w):
+ *   powerlaw  power-law (Pareto) request sizes, random frees around a
+ *             steady live set
+ *   bimodal   mix of small and large requests, random frees
+ *   fifo      producer/consumer queue: the oldest block is freed first
+ *   lifo      stack: the youngest block is freed first
+ *   mixed     a few long-lived blocks among many short-lived ones
+ *   realloc   buffers growing through realloc chains among small blocks
+ *   phases    a sequence of phases with different sizes and live sets
+ *
+ * The same seed always yields the same trace. Every trace is balanced:
+ * the blocks still live at the end are freed. With -b the trace is
+ * written in the binary format read_trace also accepts, which is much
+ * faster to load for traces of millions of ops.
+ *
+ * usage: mgen [-hb] [-w <workload>] [-n <ops>] [-s <seed>] [-l <live>]
+ *             [-m <min>] [-M <max>] [-o <file>]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "trace.h"
+
+/* Parameters, set from the command line */
+static long num_ops = 100000;     /* -n: ops to generate (approx.) */
+static unsigned long long seed = 1; /* -s */
+static int live_target = 1000;    /* -l: blocks live in steady state */
+static int min_size = 8;          /* -m */
+static int max_size = 1 << 16;    /* -M */
+
+/* The trace being built */
+static traceop_t *ops;
+static long nops, maxops;
+static int num_ids;
+static long live_bytes, peak_bytes;
+static int *sizes;                /* current size of each id */
+static int *pos;                  /* position of each id in live */
+static int maxids;
+
+/* Ids of live blocks, in allocation order for fifo/lifo */
+static int *live;
+static int nlive, maxlive;
+
+static unsigned long long rng;
+
+static void usage(void);
+
+/*
+ * rand_u64 - xorshift64*, so traces do not depend on the libc rand()
+ */
+static unsigned long long rand_u64(void)
+{
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 2685821657736338717ULL;
+}
+
+/* rand_unit - Uniform in [0, 1) */
+static double rand_unit(void)
+{
+    return (rand_u64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* rand_range - Uniform integer in [lo, hi] */
+static int rand_range(int lo, int hi)
+{
+    return lo + (int)(rand_unit() * (hi - lo + 1));
+}
+
+/* size_powerlaw - Pareto sizes with shape alpha from min_size, capped */
+static int size_powerlaw(double alpha)
+{
+    double s = min_size / pow(1 - rand_unit(), 1 / alpha);
+
+    return s > max_size ? max_size : (int)s;
+}
+
+/* size_loguniform - Sizes spread evenly over the orders of magnitude */
+static int size_loguniform(int lo, int hi)
+{
+    return (int)exp(log(lo) + rand_unit() * (log(hi) - log(lo)));
+}
+
+/*
+ * emit - Append an op to the trace and keep the bookkeeping
+ */
+static void emit(optype_t type, int id, int size)
+{
+    if (nops == maxops) {
+	maxops = maxops ? 2 * maxops : 4096;
+	if ((ops = realloc(ops, maxops * sizeof(traceop_t))) == NULL) {
+	    fprintf(stderr, "mgen: out of memory\n");
+	    exit(1);
+	}
+    }
+    ops[nops].type = type;
+    ops[nops].index = id;
+    ops[nops].size = size;
+    nops++;
+
+    live_bytes += size - sizes[id];
+    sizes[id] = size;
+    if (live_bytes > peak_bytes)
+	peak_bytes = live_bytes;
+}
+
+/*
+ * alloc_block - Allocate a new id of the given size; returns the id
+ */
+static int alloc_block(int size)
+{
+    if (num_ids == maxids) {
+	maxids = maxids ? 2 * maxids : 4096;
+	sizes = realloc(sizes, maxids * sizeof(int));
+	pos = realloc(pos, maxids * sizeof(int));
+    }
+    if (nlive == maxlive) {
+	maxlive = maxlive ? 2 * maxlive : 4096;
+	live = realloc(live, maxlive * sizeof(int));
+    }
+    if (!sizes || !pos || !live) {
+	fprintf(stderr, "mgen: out of memory\n");
+	exit(1);
+    }
+    sizes[num_ids] = 0;
+    pos[num_ids] = nlive;
+    live[nlive++] = num_ids;
+    emit(ALLOC, num_ids, size < 1 ? 1 : size);
+    return num_ids++;
+}
+
+/*
+ * free_live - Free the block at position i of the live array, keeping
+ *     the array in allocation order when ordered is set (pos[] is only
+ *     maintained for unordered removal)
+ */
+static void free_live(int i, int ordered)
+{
+    emit(FREE, live[i], 0);
+    if (ordered) {
+	memmove(&live[i], &live[i + 1], (nlive - i - 1) * sizeof(int));
+    } else {
+	live[i] = live[nlive - 1];
+	pos[live[i]] = i;
+    }
+    nlive--;
+}
+
+/* steady - Alloc or free at random so the live set hovers at target */
+static void steady(int target, int size)
+{
+    double p_alloc = nlive < target ? 0.6 : 0.4;
+
+    if (nlive == 0 || rand_unit() < p_alloc)
+	alloc_block(size);
+    else
+	free_live(rand_range(0, nlive - 1), 0);
+}
+
+static void gen_powerlaw(void)
+{
+    while (nops < num_ops)
+	steady(live_target, size_powerlaw(1.2));
+}
+
+static void gen_bimodal(void)
+{
+    while (nops < num_ops) {
+	int size = rand_unit() < 0.8 ?
+	    rand_range(min_size, 4 * min_size) :
+	    rand_range(max_size / 4, max_size);
+	steady(live_target, size);
+    }
+}
+
+/*
+ * gen_fifo - A queue of live_target blocks; the oldest is consumed
+ *     once the queue is full (a ring buffer of messages)
+ */
+static void gen_fifo(void)
+{
+    while (nops < num_ops) {
+	if (nlive < live_target && (nlive == 0 || rand_unit() < 0.55))
+	    alloc_block(size_powerlaw(1.5));
+	else
+	    free_live(0, 1);
+    }
+}
+
+/*
+ * gen_lifo - A stack that grows and shrinks in runs, like nested
+ *     scopes or a recursive parser
+ */
+static void gen_lifo(void)
+{
+    while (nops < num_ops) {
+	int run = rand_range(1, live_target / 10 + 1);
+	int push = nlive == 0 || (nlive < live_target && rand_unit() < 0.5);
+
+	while (run-- > 0 && nops < num_ops) {
+	    if (push && nlive < live_target)
+		alloc_block(size_powerlaw(1.5));
+	    else if (nlive > 0)
+		free_live(nlive - 1, 1);
+	}
+    }
+}
+
+/* Min-heap of (death op, id) for blocks with a known lifetime */
+typedef struct {
+    long death;
+    int id;
+} death_t;
+
+static death_t *deaths;
+static int ndeaths, maxdeaths;
+
+static void death_push(long death, int id)
+{
+    int i = ndeaths++;
+
+    if (ndeaths > maxdeaths) {
+	maxdeaths = maxdeaths ? 2 * maxdeaths : 4096;
+	if ((deaths = realloc(deaths, maxdeaths * sizeof(death_t))) == NULL) {
+	    fprintf(stderr, "mgen: out of memory\n");
+	    exit(1);
+	}
+    }
+    while (i > 0 && deaths[(i - 1) / 2].death > death) {
+	deaths[i] = deaths[(i - 1) / 2];
+	i = (i - 1) / 2;
+    }
+    deaths[i].death = death;
+    deaths[i].id = id;
+}
+
+static death_t death_pop(void)
+{
+    death_t top = deaths[0], last = deaths[--ndeaths];
+    int i = 0, c;
+
+    while ((c = 2 * i + 1) < ndeaths) {
+	if (c + 1 < ndeaths && deaths[c + 1].death < deaths[c].death)
+	    c++;
+	if (deaths[c].death >= last.death)
+	    break;
+	deaths[i] = deaths[c];
+	i = c;
+    }
+    deaths[i] = last;
+    return top;
+}
+
+/*
+ * gen_mixed - 5% of the blocks are long-lived, the others short-lived.
+ *     Lifetimes are exponential, with means of 10 * live and live / 2
+ *     ops, so each group holds about half of the live set.
+ */
+static void gen_mixed(void)
+{
+    long lifetime;
+
+    while (nops < num_ops) {
+	while (ndeaths > 0 && deaths[0].death <= nops)
+	    free_live(pos[death_pop().id], 0);
+	if (rand_unit() < 0.05) {
+	    lifetime = 1 + (long)(-log(1 - rand_unit()) * 10 * live_target);
+	    death_push(nops + lifetime,
+		       alloc_block(size_loguniform(min_size, max_size)));
+	} else {
+	    lifetime = 1 + (long)(-log(1 - rand_unit()) * live_target / 2);
+	    death_push(nops + lifetime, alloc_block(size_powerlaw(1.5)));
+	}
+    }
+    free(deaths);
+    deaths = NULL;
+    ndeaths = maxdeaths = 0;
+}
+
+/*
+ * gen_realloc - A few buffers grow by 10-100% per realloc up to
+ *     max_size and start over, while small blocks come and go between
+ *     them (the pattern of realloc-bal.rep and tmp.rep)
+ */
+static void gen_realloc(void)
+{
+    int nbuf = live_target / 100 + 1, i;
+    int *buf = malloc(nbuf * sizeof(int));
+
+    for (i = 0; i < nbuf; i++)
+	buf[i] = alloc_block(rand_range(min_size, 8 * min_size));
+    while (nops < num_ops) {
+	if (rand_unit() < 0.3) {
+	    int b = rand_range(0, nbuf - 1);
+	    int size = (int)(sizes[buf[b]] * (1.1 + 0.9 * rand_unit())) + 1;
+
+	    if (size > max_size) {   /* chain done: free, start a new one */
+		free_live(pos[buf[b]], 0);
+		buf[b] = alloc_block(min_size);
+	    } else {
+		emit(REALLOC, buf[b], size);
+	    }
+	} else {
+	    int nsmall = nlive - nbuf;
+	    double p_alloc = nsmall < live_target ? 0.6 : 0.4;
+
+	    if (nsmall <= 0 || rand_unit() < p_alloc) {
+		alloc_block(rand_range(min_size, 16 * min_size));
+	    } else {
+		/* free a random small block, never a buffer */
+		for (;;) {
+		    int j = rand_range(0, nlive - 1), k;
+
+		    for (k = 0; k < nbuf && buf[k] != live[j]; k++)
+			;
+		    if (k == nbuf) {
+			free_live(j, 0);
+			break;
+		    }
+		}
+	    }
+	}
+    }
+    free(buf);
+}
+
+/*
+ * gen_phases - Eight phases; each picks its own size range and live
+ *     set (at most live * 2 KB) and, when it ends, frees 90% of what
+ *     is live, chosen at random
+ */
+static void gen_phases(void)
+{
+    int phase, nphases = 8, k;
+
+    for (phase = 0; phase < nphases; phase++) {
+	long end = num_ops * (phase + 1) / nphases;
+	int lo = size_loguniform(min_size, max_size / 4 > min_size ?
+				 max_size / 4 : min_size);
+	int hi = lo * 4 > max_size ? max_size : lo * 4;
+	long target = rand_range(live_target / 4 + 1, live_target * 2);
+
+	if (target * (lo + hi) / 2 > live_target * 2048L)
+	    target = live_target * 4096L / (lo + hi) + 1;
+
+	while (nops < end)
+	    steady(target, rand_range(lo, hi));
+	for (k = nlive * 9 / 10; k > 0; k--)
+	    free_live(rand_range(0, nlive - 1), 0);
+    }
+}
+
+/*
+ * write_trace - Write the trace in text or binary format
+ */
+static void write_trace(FILE *fp, int binary)
+{
+    long i;
+
+    if (binary) {
+	int header[4];
+
+	header[0] = (int)peak_bytes;
+	header[1] = num_ids;
+	header[2] = (int)nops;
+	header[3] = 1;
+	fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), fp);
+	fwrite(header, sizeof(int), 4, fp);
+	fwrite(ops, sizeof(traceop_t), nops, fp);
+	return;
+    }
+    fprintf(fp, "%ld\n%d\n%ld\n%d\n", peak_bytes, num_ids, nops, 1);
+    for (i = 0; i < nops; i++) {
+	if (ops[i].type == FREE)
+	    fprintf(fp, "f %d\n", ops[i].index);
+	else
+	    fprintf(fp, "%c %d %d\n", ops[i].type == ALLOC ? 'a' : 'r',
+		    ops[i].index, ops[i].size);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static struct {
+	char *name;
+	void (*gen)(void);
+    } workloads[] = {
+	{ "powerlaw", gen_powerlaw }, { "bimodal", gen_bimodal },
+	{ "fifo", gen_fifo }, { "lifo", gen_lifo }, { "mixed", gen_mixed },
+	{ "realloc", gen_realloc }, { "phases", gen_phases }, { NULL, NULL }
+    };
+    char *workload = "powerlaw", *outname = NULL;
+    int c, i, binary = 0;
+    FILE *out = stdout;
+
+    while ((c = getopt(argc, argv, "hbw:n:s:l:m:M:o:")) != EOF) {
+	switch (c) {
+	case 'b':
+	    binary = 1;
+	    break;
+	case 'w':
+	    workload = optarg;
+	    break;
+	case 'n':
+	    num_ops = atol(optarg);
+	    break;
+	case 's':
+	    seed = strtoull(optarg, NULL, 0);
+	    break;
+	case 'l':
+	    live_target = atoi(optarg);
+	    break;
+	case 'm':
+	    min_size = atoi(optarg);
+	    break;
+	case 'M':
+	    max_size = atoi(optarg);
+	    break;
+	case 'o':
+	    outname = optarg;
+	    break;
+	case 'h':
+	default:
+	    usage();
+	    exit(c == 'h' ? 0 : 1);
+	}
+    }
+    if (num_ops <= 0 || live_target <= 0 || min_size <= 0 ||
+	max_size < min_size) {
+	usage();
+	exit(1);
+    }
+    rng = seed * 0x9E3779B97F4A7C15ULL + 1;   /* never 0 */
+
+    for (i = 0; workloads[i].name != NULL; i++)
+	if (strcmp(workloads[i].name, workload) == 0)
+	    break;
+    if (workloads[i].name == NULL) {
+	fprintf(stderr, "mgen: unknown workload %s\n", workload);
+	usage();
+	exit(1);
+    }
+    workloads[i].gen();
+    while (nlive > 0)             /* balance the trace */
+	free_live(nlive - 1, 0);
+
+    if (outname && (out = fopen(outname, binary ? "wb" : "w")) == NULL) {
+	fprintf(stderr, "Could not open %s\n", outname);
+	exit(1);
+    }
+    write_trace(out, binary);
+    if (out != stdout)
+	fclose(out);
+    return 0;
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mgen [-hb] [-w <workload>] [-n <ops>] [-s <seed>] [-l <live>]\n");
+    fprintf(stderr, "            [-m <min>] [-M <max>] [-o <file>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h             Print this message.\n");
+    fprintf(stderr, "\t-b             Write the binary trace format.\n");
+    fprintf(stderr, "\t-w <workload>  powerlaw, bimodal, fifo, lifo, mixed, realloc or phases.\n");
+    fprintf(stderr, "\t-n <ops>       Approximate number of ops (default 100000).\n");
+    fprintf(stderr, "\t-s <seed>      Random seed (default 1).\n");
+    fprintf(stderr, "\t-l <live>      Blocks live in steady state (default 1000).\n");
+    fprintf(stderr, "\t-m <min>       Smallest request size (default 8).\n");
+    fprintf(stderr, "\t-M <max>       Largest request size (default 65536).\n");
+    fprintf(stderr, "\t-o <file>      Write to <file> instead of stdout.\n");
+}
@@ -0,0 +1,57 @@
+/*
+ * mm-policy.cpp - Configurations of the policy allocator (mmpolicy.hpp)
+ *
+ * Each MM_POLICY line instantiates one combination of policies and
+ * defines a registry entry for it, policy_<id>_alloc, listed in mmreg.c.
+ * The instances do not collect mm_stats_t counters.
+ */
+#include "mmpolicy.hpp"
+
+extern "C" {
+#include "mmreg.h"
+}
+
+using namespace mmpolicy;
+
+using Tags4 = Layout<std::uint32_t, true>;     /* 4 byte header and footer */
+using Header4 = Layout<std::uint32_t, false>;  /* 4 byte header only */
+using Header8 = Layout<std::uint64_t, false>;  /* 8 byte header only */
+using Chunk = FixedChunk<4096>;
+using Grow = Geometric<4096, 1, 8>;
+
+#define MM_POLICY(id, name, description, ...)				\
+    static Allocator<__VA_ARGS__> id##_heap;				\
+    static int id##_init(void) { return id##_heap.init(); }		\
+    static void *id##_malloc(size_t size) { return id##_heap.malloc(size); } \
+    static void id##_free(void *ptr) { id##_heap.free(ptr); }		\
+    static void *id##_realloc(void *ptr, size_t size)			\
+    {									\
+	return id##_heap.realloc(ptr, size);				\
+    }									\
+    extern "C" mm_alloc_t policy_##id##_alloc;				\
+    mm_alloc_t policy_##id##_alloc = {					\
+	name, description, id##_init, id##_malloc, id##_free,		\
+	id##_realloc, nullptr, 1					\
+    };
+
+MM_POLICY(implicit_first, "p-implicit-first",
+	  "policy: 4 byte tags, implicit list, first fit",
+	  Tags4, Implicit, FirstFit, Chunk)
+MM_POLICY(implicit_next, "p-implicit-next",
+	  "policy: 4 byte header, implicit list, next fit",
+	  Header4, Implicit, NextFit, Chunk)
+MM_POLICY(lifo_first, "p-lifo-first",
+	  "policy: 4 byte tags, explicit LIFO list, first fit",
+	  Tags4, ExplicitLifo, FirstFit, Chunk)
+MM_POLICY(addr_first, "p-addr-first",
+	  "policy: 4 byte header, address-ordered list, first fit",
+	  Header4, AddressOrdered, FirstFit, Chunk)
+MM_POLICY(addr_best, "p-addr-best",
+	  "policy: 4 byte header, address-ordered list, best fit, geometric",
+	  Header4, AddressOrdered, BestFit, Grow)
+MM_POLICY(seg_first, "p-seg-first",
+	  "policy: 4 byte header, 16 segregated lists, first fit",
+	  Header4, Segregated<16>::List, FirstFit, Chunk)
+MM_POLICY(seg_best, "p-seg-best",
+	  "policy: 8 byte header, 16 segregated lists, best fit, geometric",
+	  Header8, Segregated<16>::List, BestFit, Grow)
@@ -75,6 +75,12 @@
  
 #include "mm.h"
 #include "memlib.h"
+#include "mmprof.h"
+#include "mmcapture.h"
+#include "config.h"    /* MAX_HEAP bounds requests (and sizes the bitmap) */
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /*********************************************************
 * NOTE TO STUDENTS: Before you do anything else, please
@@ -129,6 +135,59 @@ team_t team = {
 #define GET_SIZE(p)  (GET(p) & ~0x7)
 #define GET_ALLOC(p) (GET(p) & 0x1)
 
+/* The helpers between an entry point and prof_alloc are always inlined:
+   the profiler takes its caller's frame for the entry point's */
+#define INLINE       inline __attribute__((always_inline))
+
+/* Flag of an allocated block that the heap profiler tracks (mmprof.c) */
+#define SAMPLED      0x2
+
+/* Flag of a free block whose payload is zero from bp + ZOFF(bp) on.
+   The offset is kept behind the links, so the zero part starts at
+   ZMIN bytes into the payload at the earliest. */
+#define ZEROED       0x4
+#define ZOFF(bp)     (*(unsigned int *)((char *)(bp) + ALIGNMENT + sizeof(void *)))
+#define ZMIN         (ALIGNMENT + sizeof(void *) + WSIZE)
+
+/* Flag of an allocated block whose lifetime is being measured for
+   MM_HINT_AUTO. Only free blocks are ZEROED, so the bit is shared. */
+#define TRACKED      0x4
+
+/* Lifetime prediction (MM_HINT_AUTO): one in LIFE_EVERY automatic
+   allocations of each key is tracked, in LIFE_SLOTS slots taken in
+   turn. A block freed before its slot is taken again is short-lived,
+   one still alive then is not. Each key (the allocation site, hashed
+   to an offset, plus the request size in 8 byte steps below 1 KB or
+   the size class above) keeps a score of its blocks' outcomes,
+   saturating at +-LIFE_CAP. The sizes of one site take consecutive
+   keys, so they never share a score. */
+#define LIFE_EVERY   16
+#define LIFE_SLOTS   64
+#define LIFE_CAP     8
+#define LIFE_SMALL   128
+#define LIFE_KEYS    1024
+
+#ifdef ADDRESS_ORDERED
+/* Hierarchical bitmap of the free blocks, for the address-ordered
+   list: bit i of level 0 is set if a free block starts ALIGNMENT * i
+   bytes into the heap, and a bit of level l + 1 is set if the word of
+   level l it stands for is not zero. The top level is one word. */
+#define BM_BITS      (8 * sizeof(unsigned long))
+#define BM_WORDS(n)  (((n) + BM_BITS - 1) / BM_BITS)
+#define BM_N0        (MAX_HEAP / ALIGNMENT)
+#define BM_N1        BM_WORDS(BM_N0)
+#define BM_N2        BM_WORDS(BM_N1)
+#define BM_N3        BM_WORDS(BM_N2)
+#define BM_N4        BM_WORDS(BM_N3)
+#define BM_N5        BM_WORDS(BM_N4)
+#define BM_LEVELS    6
+#define BM_INDEX(bp) (((char *)(bp) - (char *)mem_heap_lo()) / ALIGNMENT)
+#define BM_BLOCK(i)  ((char *)mem_heap_lo() + (i) * ALIGNMENT)
+#endif
+
+/* Zeroing of at least this many bytes bypasses the caches */
+#define ZERO_STREAM  (256*1024)
+
 /* Given block ptr bp, compute address of its header and footer */
 #define HDRP(bp)       ((char *)(bp) - WSIZE)  
 #define FTRP(bp)       ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
@@ -148,17 +207,61 @@ team_t team = {
 /* Global variables */
 static char *heap_listp;  /* pointer to first block */  
 static char *FreeListRoot; /* Points to the head of the free lits */
+static mm_stats_t stats;   /* counters reported by mm_stats */
+
+/* Lifetimes for MM_HINT_AUTO */
+static struct {
+    char *bp;                          /* tracked block, NULL if none */
+    int key;                           /* its life_key */
+} life_slot[LIFE_SLOTS];
+static signed char life_score[LIFE_KEYS]; /* > 0 short-lived, < 0 long */
+static int life_next;                  /* slot of the next tracked block */
+static unsigned char life_tick[LIFE_KEYS]; /* automatic allocations */
+
+#ifdef ADDRESS_ORDERED
+static unsigned long bm0[BM_WORDS(BM_N0)], bm1[BM_WORDS(BM_N1)],
+    bm2[BM_WORDS(BM_N2)], bm3[BM_WORDS(BM_N3)], bm4[BM_WORDS(BM_N4)],
+    bm5[BM_WORDS(BM_N5)];
+static unsigned long *bm[BM_LEVELS] = { bm0, bm1, bm2, bm3, bm4, bm5 };
+static size_t bm_top;      /* bits of level 0 ever set are below this */
+typedef char bm_levels_fit[BM_N5 <= BM_BITS ? 1 : -1];
+#endif
 
 /* function prototypes for internal helper routines */
 static void *extend_heap(size_t words);
 static void place(void *bp, size_t asize);
+static void *place_high(void *bp, size_t asize);
+static void *find_high_fit(size_t asize);
+static void *find_low_fit(size_t asize);
 static void *find_fit(size_t asize);
+static void *find_aligned_fit(size_t alignment, size_t asize, size_t *lead);
+static size_t aligned_lead(void *bp, size_t alignment);
 static void *coalesce(void *bp);
 static void printblock(void *bp); 
 static void checkblock(void *bp);
 static void put_on_heap(void *bp, size_t size, int bool);
 static void remove_block(void *p);
 static void add_block(void *p);
+static int size_class(size_t size);
+static size_t adjust_size(size_t size);
+static INLINE void sample_block(void *bp, size_t size);
+static INLINE void record_alloc(void *bp, size_t size);
+static char *zero_from(void *bp);
+static void mark_zero(void *bp, char *z);
+static char *zero_join(void *l, void *r, char *zr);
+static void zero_bytes(void *p, size_t n);
+static int cmp_addr(const void *a, const void *b);
+static int life_key(void *site, size_t asize);
+static int life_hint(int key);
+static void life_learn(int key, int died);
+static void life_track(void *bp, int key);
+static void life_end(void *bp);
+#ifdef ADDRESS_ORDERED
+static void bm_reset(void);
+static void bm_set(size_t i);
+static void bm_clear(size_t i);
+static long bm_prev(size_t i);
+#endif
 void print_free(); //helper funcitons
 void print_heap();
 /* 
@@ -181,8 +284,22 @@ int mm_init(void)
     PUT(heap_listp+DSIZE, 0); //back link
     PUT(heap_listp+DSIZE+WSIZE, 0); // forward link
 
+    /* The word before the first chunk's header reads as a zero size
+       footer, which coalesce takes as an allocated left neighbour.
+       The heap may be reused after mem_reset_brk, so clear it. */
+    PUT(heap_listp+2*HEAP_SIZE-2*DSIZE, 0);
+
     /*initilize free list root to point to the head of the heap*/
     FreeListRoot = heap_listp;
+    memset(&stats, 0, sizeof(stats));
+    memset(life_slot, 0, sizeof(life_slot));
+    memset(life_score, 0, sizeof(life_score));
+    memset(life_tick, 0, sizeof(life_tick));
+    life_next = 0;
+#ifdef ADDRESS_ORDERED
+    bm_reset();
+#endif
+    prof_heap_reset();
 
     /* Extend the empty heap with a free block of CHUNKSIZE bytes */
     if (extend_heap(CHUNKSIZE/DSIZE) == NULL)
@@ -206,26 +323,364 @@ void *mm_malloc(size_t size)
         return NULL;
 
     /*Adjusting block size*/
-    if((ALIGN(size) + DSIZE) < HEAP_SIZE)
-        asize = HEAP_SIZE;
-    else
-      asize = ALIGN(size) + DSIZE;
+    if ((asize = adjust_size(size)) == 0)
+        return NULL;
 
     /* Search the free list for a fit */
-    if ((bp = find_fit(asize)) != NULL) {
-        place(bp, asize);
-        return bp;
+    if ((bp = find_fit(asize)) == NULL) {
+        /* No fit found. Get more memory and place the block */
+        extendsize = MAX(asize,CHUNKSIZE);
+        if ((bp = extend_heap(extendsize/WSIZE)) == NULL)
+            return NULL;
     }
-
-    /* No fit found. Get more memory and place the block */
-    extendsize = MAX(asize,CHUNKSIZE);
-    if ((bp = extend_heap(extendsize/WSIZE)) == NULL)
-        return NULL;
     place(bp, asize);
+
+    record_alloc(bp, size);
     return bp;
 } 
 /* $end mmmalloc */
 
+/*
+ * mm_malloc_hint - mm_malloc with a hint of how long the block lives.
+ * Long-lived blocks take the bottom of the lowest fit and short-lived
+ * ones the top of the highest, so that the two kinds are packed at
+ * opposite ends of the free space instead of interleaving, and the
+ * space of short-lived blocks coalesces back into large free blocks
+ * when they die. Both fits scan the whole free list. MM_HINT_AUTO
+ * predicts the hint from the blocks of the same size, allocated from
+ * the same call site (the return address), tracked so far; unhinted
+ * blocks are placed by mm_malloc.
+ */
+/* $begin mmmallochint */
+void *mm_malloc_hint(size_t size, int hint)
+{
+    size_t asize;
+    char *bp;
+    int key = -1;
+
+    if (size <= 0)
+        return NULL;
+
+    if ((asize = adjust_size(size)) == 0)
+        return NULL;
+
+    if (hint == MM_HINT_AUTO) {
+        key = life_key(__builtin_return_address(0), asize);
+        hint = life_hint(key);
+    }
+    if (hint != MM_HINT_SHORT && hint != MM_HINT_LONG) {
+        bp = mm_malloc(size);
+    } else {
+        bp = hint == MM_HINT_SHORT ? find_high_fit(asize) : find_low_fit(asize);
+        if (bp == NULL &&
+            (bp = extend_heap(MAX(asize,CHUNKSIZE)/WSIZE)) == NULL)
+            return NULL;
+        if (hint == MM_HINT_SHORT)
+            bp = place_high(bp, asize);
+        else
+            place(bp, asize);
+        record_alloc(bp, size);
+    }
+
+    if (key >= 0 && bp != NULL && ++life_tick[key] % LIFE_EVERY == 0)
+        life_track(bp, key);
+    return bp;
+}
+/* $end mmmallochint */
+
+/*
+ * life_key - The key lifetimes of blocks of asize bytes allocated
+ * from site are kept under
+ */
+/* $begin lifekey */
+static int life_key(void *site, size_t asize)
+{
+    unsigned long k = ((unsigned long)site >> 2) * 2654435761UL >> 8;
+
+    if (asize < LIFE_SMALL * ALIGNMENT)
+        k += asize / ALIGNMENT;
+    else
+        k += LIFE_SMALL + size_class(asize);
+    return k % LIFE_KEYS;
+}
+/* $end lifekey */
+
+/*
+ * life_hint - Hint for a block under key, from the score of the blocks
+ * tracked under it; none while they are undecided
+ */
+/* $begin lifehint */
+static int life_hint(int key)
+{
+    if (life_score[key] > 0)
+        return MM_HINT_SHORT;
+    if (life_score[key] < 0)
+        return MM_HINT_LONG;
+    return MM_HINT_NONE;
+}
+/* $end lifehint */
+
+/*
+ * life_learn - Score a tracked block of key that died (or not) while
+ * tracked
+ */
+/* $begin lifelearn */
+static void life_learn(int key, int died)
+{
+    if (died && life_score[key] < LIFE_CAP)
+        life_score[key]++;
+    else if (!died && life_score[key] > -LIFE_CAP)
+        life_score[key]--;
+}
+/* $end lifelearn */
+
+/*
+ * life_track - Start tracking bp. The block tracked in the slot it
+ * takes, if still alive, has outlived its turn: it is long-lived.
+ */
+/* $begin lifetrack */
+static void life_track(void *bp, int key)
+{
+    int i = life_next;
+    char *old = life_slot[i].bp;
+
+    life_next = (life_next + 1) % LIFE_SLOTS;
+    if (old != NULL) {
+        life_learn(life_slot[i].key, 0);
+        PUT(HDRP(old), GET(HDRP(old)) & ~TRACKED);
+        PUT(FTRP(old), GET(FTRP(old)) & ~TRACKED);
+    }
+    life_slot[i].bp = bp;
+    life_slot[i].key = key;
+    PUT(HDRP(bp), GET(HDRP(bp)) | TRACKED);
+    PUT(FTRP(bp), GET(FTRP(bp)) | TRACKED);
+}
+/* $end lifetrack */
+
+/*
+ * life_end - The tracked block bp is freed within its turn
+ */
+/* $begin lifeend */
+static void life_end(void *bp)
+{
+    int i;
+
+    for (i = 0; i < LIFE_SLOTS; i++) {
+        if (life_slot[i].bp == bp) {
+            life_learn(life_slot[i].key, 1);
+            life_slot[i].bp = NULL;
+            return;
+        }
+    }
+}
+/* $end lifeend */
+
+/*
+ * mm_memalign - Allocate a block whose payload is aligned to alignment,
+ * a power of two (NULL for any other alignment, even a small one).
+ * The slack in front of the aligned payload is split off the fit as a
+ * free block (at least HEAP_SIZE bytes), not padded into the allocated
+ * block; place then splits off the tail.
+ */
+/* $begin mmmemalign */
+void *mm_memalign(size_t alignment, size_t size)
+{
+    size_t asize, csize, lead;
+    char *bp;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        return NULL;
+    if (alignment <= ALIGNMENT)
+        return mm_malloc(size);
+    if (size <= 0 || alignment > MAX_HEAP)
+        return NULL;
+
+    if ((asize = adjust_size(size)) == 0)
+        return NULL;
+
+    if ((bp = find_aligned_fit(alignment, asize, &lead)) == NULL) {
+        /* room for the block behind the largest possible lead */
+        if ((bp = extend_heap(MAX(asize + alignment + HEAP_SIZE,
+                                  CHUNKSIZE)/WSIZE)) == NULL)
+            return NULL;
+        lead = aligned_lead(bp, alignment);
+    }
+
+    if (lead > 0) {
+        char *z = zero_from(bp);
+
+        csize = GET_SIZE(HDRP(bp));
+        remove_block(bp);
+        put_on_heap(bp, lead, 0);
+        mark_zero(bp, z);
+        add_block(bp);
+        bp += lead;
+        put_on_heap(bp, csize - lead, 0);
+        mark_zero(bp, z);
+        add_block(bp);
+        stats.splits++;
+    }
+    place(bp, asize);
+
+    record_alloc(bp, size);
+    return bp;
+}
+/* $end mmmemalign */
+
+/*
+ * mm_calloc - Allocate a zeroed array of nmemb elements of size bytes.
+ * Only the part of the fit that is not known to be zero is cleared:
+ * storage fresh from memlib is, and free blocks remember (ZEROED) how
+ * much of them still is.
+ */
+/* $begin mmcalloc */
+void *mm_calloc(size_t nmemb, size_t size)
+{
+    size_t bytes, asize;
+    char *bp, *z;
+
+    if (nmemb != 0 && size > (size_t)-1 / nmemb)
+        return NULL;
+    if ((bytes = nmemb * size) == 0)
+        return NULL;
+
+    if ((asize = adjust_size(bytes)) == 0)
+        return NULL;
+
+    if ((bp = find_fit(asize)) == NULL &&
+        (bp = extend_heap(MAX(asize,CHUNKSIZE)/WSIZE)) == NULL)
+        return NULL;
+    z = zero_from(bp);
+    place(bp, asize);
+    if (z == NULL || z > bp + bytes)
+        z = bp + bytes;
+    zero_bytes(bp, z - bp);
+
+    record_alloc(bp, bytes);
+    return bp;
+}
+/* $end mmcalloc */
+
+/*
+ * zero_from - Where the known zero part of the free block bp starts,
+ * or NULL if none of it is known to be zero
+ */
+/* $begin zerofrom */
+static char *zero_from(void *bp)
+{
+    if (GET(HDRP(bp)) & ZEROED)
+        return (char *)bp + ZOFF(bp);
+    return NULL;
+}
+/* $end zerofrom */
+
+/*
+ * mark_zero - Record that the free block bp is zero from z on, as far
+ * as the tags and links that it now has allow
+ */
+/* $begin markzero */
+static void mark_zero(void *bp, char *z)
+{
+    if (z == NULL)
+        return;
+    if (z < (char *)bp + ZMIN)
+        z = (char *)bp + ZMIN;
+    if (z < FTRP(bp)) {
+        ZOFF(bp) = z - (char *)bp;
+        PUT(HDRP(bp), GET(HDRP(bp)) | ZEROED);
+        PUT(FTRP(bp), GET(FTRP(bp)) | ZEROED);
+    }
+}
+/* $end markzero */
+
+/*
+ * zero_join - Zero part of the union of the free block l and the free
+ * space right after it, starting at r and zero from zr. If r is all
+ * zero, the words between the two zero parts are cleared so that they
+ * join; both must be off the free list, and l's tags still intact.
+ */
+/* $begin zerojoin */
+static char *zero_join(void *l, void *r, char *zr)
+{
+    char *zl = zero_from(l);
+
+    if (zl != NULL && zr == (char *)r + ZMIN) {
+        memset(FTRP(l), 0, (char *)r + ZMIN - FTRP(l));
+        return zl;
+    }
+    return zr;
+}
+/* $end zerojoin */
+
+/*
+ * zero_bytes - memset to zero, with non-temporal stores for large n so
+ * that clearing does not evict the working set from the caches
+ */
+/* $begin zerobytes */
+static void zero_bytes(void *p, size_t n)
+{
+#ifdef __SSE2__
+    if (n >= ZERO_STREAM) {
+        char *q = p, *end = q + n;
+        size_t head = (16 - (size_t)q % 16) % 16;
+        __m128i zero = _mm_setzero_si128();
+
+        memset(q, 0, head);
+        for (q += head; q + 16 <= end; q += 16)
+            _mm_stream_si128((__m128i *)q, zero);
+        _mm_sfence();
+        memset(q, 0, end - q);
+        return;
+    }
+#endif
+    memset(p, 0, n);
+}
+/* $end zerobytes */
+
+/*
+ * adjust_size - The block size for a payload of size bytes: aligned,
+ * with room for the header and footer, and at least HEAP_SIZE. 0 if
+ * the heap could never hold it, checked before rounding (which would
+ * wrap around for sizes near SIZE_MAX).
+ */
+/* $begin adjustsize */
+static size_t adjust_size(size_t size)
+{
+    if (size > MAX_HEAP)
+        return 0;
+    if ((ALIGN(size) + DSIZE) < HEAP_SIZE)
+        return HEAP_SIZE;
+    return ALIGN(size) + DSIZE;
+}
+/* $end adjustsize */
+
+/*
+ * sample_block - Hand a block picked by the sampler to the heap
+ * profiler and flag it so that mm_free reports it back
+ */
+/* $begin sampleblock */
+static INLINE void sample_block(void *bp, size_t size)
+{
+    if (prof_alloc(bp, size)) {
+        PUT(HDRP(bp), GET(HDRP(bp)) | SAMPLED);
+        PUT(FTRP(bp), GET(FTRP(bp)) | SAMPLED);
+    }
+}
+/* $end sampleblock */
+
+/*
+ * record_alloc - Report a new block of size bytes to the heap profiler
+ * (unsampled allocations only count down) and the capture
+ */
+/* $begin recordalloc */
+static INLINE void record_alloc(void *bp, size_t size)
+{
+    if (PROF_SAMPLE(size))
+        sample_block(bp, size);
+    CAPTURE('a', bp, NULL, size);
+}
+/* $end recordalloc */
+
 /*
  * Free a block 
  */
@@ -233,18 +688,156 @@ void *mm_malloc(size_t size)
 void mm_free(void *bp)
 {
     size_t size = GET_SIZE(HDRP(bp));
+
+    CAPTURE('f', bp, NULL, 0);
+    if (GET(HDRP(bp)) & SAMPLED)
+        prof_free(bp);
+    if (GET(HDRP(bp)) & TRACKED)
+        life_end(bp);
+    stats.bytes_in_use -= size;
     put_on_heap(bp, size, 0);
     coalesce(bp);
 }
 /* $end mmfree */
 
+/*
+ * mm_free_sized - Free a block allocated (or last expanded) with
+ * size bytes: an alias of mm_free. The header is read anyway, to
+ * coalesce, so the size saves no work; it only serves to check the
+ * caller (assert, on adjust_size so that huge sizes cannot wrap).
+ */
+/* $begin mmfreesized */
+void mm_free_sized(void *bp, size_t size)
+{
+    assert(adjust_size(size) != 0 && adjust_size(size) <= GET_SIZE(HDRP(bp)));
+    mm_free(bp);
+}
+/* $end mmfreesized */
+
+/*
+ * mm_malloc_batch - Allocate n blocks of size bytes into out[]. They
+ * are carved side by side out of one fit for all of them, taking it
+ * off the free list once. Returns n, or 0 if there is no memory.
+ */
+/* $begin mmmallocbatch */
+int mm_malloc_batch(size_t size, int n, void **out)
+{
+    size_t asize, csize, total;
+    char *bp, *z;
+    int i;
+
+    if (size <= 0 || n <= 0)
+        return 0;
+
+    if ((asize = adjust_size(size)) == 0 || (size_t)n > MAX_HEAP / asize)
+        return 0;              /* the blocks could never fit in the heap */
+    total = asize * n;
+
+    if ((bp = find_fit(total)) == NULL &&
+        (bp = extend_heap(MAX(total,CHUNKSIZE)/WSIZE)) == NULL)
+        return 0;
+    csize = GET_SIZE(HDRP(bp));
+    z = zero_from(bp);
+    remove_block(bp);
+
+    /* the last block takes a remainder too small to be a block */
+    if (csize - total < HEAP_SIZE)
+        total = csize;
+    for (i = 0; i < n; i++) {
+        out[i] = bp;
+        put_on_heap(bp, i < n - 1 ? asize : total - asize * (n - 1), 1);
+        record_alloc(bp, size);
+        bp = NEXT_BLKP(bp);
+    }
+    stats.bytes_in_use += total;
+    if (csize > total) {
+        put_on_heap(bp, csize - total, 0);
+        mark_zero(bp, z);
+        stats.splits++;
+        coalesce(bp);
+    }
+    return n;
+}
+/* $end mmmallocbatch */
+
+/*
+ * mm_free_batch - Free the n blocks of ptrs[], which is sorted by
+ * address in place. Each run of adjacent blocks is merged into one
+ * free block before it is coalesced and listed, once.
+ */
+/* $begin mmfreebatch */
+void mm_free_batch(void **ptrs, int n)
+{
+    size_t run;
+    char *bp;
+    int i, j;
+
+    for (i = 1; i < n && (char *)ptrs[i - 1] < (char *)ptrs[i]; i++)
+        ;
+    if (i < n)
+        qsort(ptrs, n, sizeof(void *), cmp_addr);
+
+    for (i = 0; i < n; i = j) {
+        run = 0;
+        for (j = i; j < n && (j == i || ptrs[j] == NEXT_BLKP(ptrs[j - 1])); j++) {
+            bp = ptrs[j];
+            CAPTURE('f', bp, NULL, 0);
+            if (GET(HDRP(bp)) & SAMPLED)
+                prof_free(bp);
+            if (GET(HDRP(bp)) & TRACKED)
+                life_end(bp);
+            run += GET_SIZE(HDRP(bp));
+        }
+        stats.bytes_in_use -= run;
+        put_on_heap(ptrs[i], run, 0);
+        coalesce(ptrs[i]);
+    }
+}
+/* $end mmfreebatch */
+
+/*
+ * cmp_addr - qsort order of block pointers by address
+ */
+/* $begin cmpaddr */
+static int cmp_addr(const void *a, const void *b)
+{
+    char *x = *(char * const *)a, *y = *(char * const *)b;
+
+    return x < y ? -1 : x > y;
+}
+/* $end cmpaddr */
+
 /*
  *Adding block to free list  using FIFO, always adding free block to the root of the list
+ * (built with ADDRESS_ORDERED: after the free block before it in the
+ * heap, found in the bitmap, so that the list is sorted by address)
 */
 /*$begin addblock*/
 static void add_block(void *p){
 
    void *head = (void*)FreeListRoot;
+   size_t size = GET_SIZE(HDRP(p));
+
+   stats.free_blocks[size_class(size)]++;
+   stats.free_bytes[size_class(size)] += size;
+   stats.bytes_free += size;
+#ifdef ADDRESS_ORDERED
+   {
+     long prev = bm_prev(BM_INDEX(p));
+
+     bm_set(BM_INDEX(p));
+     if (prev >= 0) { //insert after the free block before p
+       void *pred = BM_BLOCK(prev);
+       void *next = FORWARD_LINK(pred);
+
+       FORWARD_LINK(p) = next;
+       BACK_LINK(p) = pred;
+       FORWARD_LINK(pred) = p;
+       BACK_LINK(next) = p;
+       return;
+     }
+   }
+#endif
   /*if free list is empty, add the first block to the list*/
    if(FreeListRoot == NULL){
     FreeListRoot = p;
@@ -269,6 +862,14 @@ static void remove_block(void *p){
   /*temp variables for accessing backlinks and forward links*/
   void *temp_back = BACK_LINK(p);
   void *temp_forward = FORWARD_LINK(p);
+  size_t size = GET_SIZE(HDRP(p)); /* callers remove before rewriting the tags */
+
+  stats.free_blocks[size_class(size)]--;
+  stats.free_bytes[size_class(size)] -= size;
+  stats.bytes_free -= size;
+#ifdef ADDRESS_ORDERED
+  bm_clear(BM_INDEX(p));
+#endif
 
   if(BACK_LINK(p) == NULL){ //if block is at head of the free list
     //Now the head pointer points to the node after discard(could be NULL)
@@ -289,8 +890,94 @@ static void remove_block(void *p){
 } 
 /*$end removeblock*/
 
+#ifdef ADDRESS_ORDERED
+/*
+ * bm_reset - Clear the bitmap, as far as it was ever used
+ */
+/*$begin bmreset*/
+static void bm_reset(void)
+{
+    size_t n = bm_top;
+    int l;
+
+    for (l = 0; l < BM_LEVELS; l++) {
+        n = BM_WORDS(n);
+        memset(bm[l], 0, n * sizeof(unsigned long));
+    }
+    bm_top = 0;
+}
+/*$end bmreset*/
+
+/*
+ * bm_set - Set bit i of level 0, and above it the bits of the words
+ * that were zero
+ */
+/*$begin bmset*/
+static void bm_set(size_t i)
+{
+    unsigned long old;
+    int l;
+
+    if (i >= bm_top)
+        bm_top = i + 1;
+    for (l = 0; l < BM_LEVELS; l++) {
+        old = bm[l][i / BM_BITS];
+        bm[l][i / BM_BITS] = old | 1UL << i % BM_BITS;
+        if (old != 0)
+            break;
+        i /= BM_BITS;
+    }
+}
+/*$end bmset*/
+
+/*
+ * bm_clear - Clear bit i of level 0, and above it the bits of the
+ * words that became zero
+ */
+/*$begin bmclear*/
+static void bm_clear(size_t i)
+{
+    int l;
+
+    for (l = 0; l < BM_LEVELS; l++) {
+        bm[l][i / BM_BITS] &= ~(1UL << i % BM_BITS);
+        if (bm[l][i / BM_BITS] != 0)
+            break;
+        i /= BM_BITS;
+    }
+}
+/*$end bmclear*/
+
+/*
+ * bm_prev - The highest bit of level 0 set below bit i, or -1: up the
+ * levels to the first word with a bit set below the one standing for
+ * i, then down along the highest bits
+ */
+/*$begin bmprev*/
+static long bm_prev(size_t i)
+{
+    unsigned long m = 0;
+    int l;
+
+    for (l = 0; l < BM_LEVELS; l++) {
+        m = bm[l][i / BM_BITS] & ((1UL << i % BM_BITS) - 1);
+        if (m != 0)
+            break;
+        i /= BM_BITS;
+    }
+    if (m == 0)
+        return -1;
+    i = i / BM_BITS * BM_BITS + BM_BITS - 1 - __builtin_clzl(m);
+    while (l-- > 0)
+        i = i * BM_BITS + BM_BITS - 1 - __builtin_clzl(bm[l][i]);
+    return i;
+}
+/*$end bmprev*/
+#endif
+
 /*
- * mm_realloc - naive implementation of mm_realloc
+ * mm_realloc - naive implementation of mm_realloc. Returns NULL, with
+ * ptr left allocated, if there is no memory for the new block.
  */
 /*$begin mmrealloc*/
 void *mm_realloc(void *ptr, size_t size)
@@ -302,7 +989,7 @@ void *mm_realloc(void *ptr, size_t size)
       mm_free(ptr);
       return NULL;
     }
-    copySize = GET_SIZE(HDRP(ptr));
+    copySize = GET_SIZE(HDRP(ptr)) - DSIZE;
 
     /*tried to implement realloc by checking right block*/
     /* void *tempNext = NEXT_BLKP(ptr);
@@ -331,19 +1018,127 @@ void *mm_realloc(void *ptr, size_t size)
       return ptr;
       }*/
 
+    capture_quiet++;   /* captured below as one 'r', not as 'a' + 'f' */
     if ((newp = mm_malloc(size)) == NULL) {
-      printf("ERROR: mm_malloc failed in mm_realloc\n");
-      exit(1);
+      capture_quiet--;
+      return NULL;
     }
 
     if (size < copySize)
         copySize = size;
     memcpy(newp, ptr, copySize);
     mm_free(ptr);
+    capture_quiet--;
+    stats.realloc_copy++;
+    CAPTURE('r', newp, ptr, size);
     return newp;
 }
 /*$end mmrealloc*/
 
+/*
+ * mm_try_expand - Grow the block bp in place to at least size bytes of
+ * payload, into the next block if that is free or into a heap
+ * extension if bp is the last block. Never moves bp. Returns 1 if bp
+ * now has size bytes, 0 (and bp unchanged) otherwise.
+ */
+/*$begin mmtryexpand*/
+int mm_try_expand(void *bp, size_t size)
+{
+    size_t asize, csize, total;
+    char *next, *z;
+    size_t flags = GET(HDRP(bp)) & (SAMPLED | TRACKED);
+
+    if ((asize = adjust_size(size)) == 0)
+        return 0;
+    csize = GET_SIZE(HDRP(bp));
+    if (asize <= csize) {
+        stats.realloc_inplace++;
+        CAPTURE('r', bp, bp, size);
+        return 1;
+    }
+
+    next = NEXT_BLKP(bp);
+    if (GET_SIZE(HDRP(next)) == 0 &&
+        (next = extend_heap(MAX(asize - csize, CHUNKSIZE)/WSIZE)) == NULL)
+        return 0;
+    if (GET_ALLOC(HDRP(next)) || csize + GET_SIZE(HDRP(next)) < asize)
+        return 0;
+
+    total = csize + GET_SIZE(HDRP(next));
+    z = zero_from(next);
+    remove_block(next);
+    if (total - asize >= HEAP_SIZE) {
+        put_on_heap(bp, asize, 1);
+        next = NEXT_BLKP(bp);
+        put_on_heap(next, total - asize, 0);
+        mark_zero(next, z);
+        add_block(next);
+        stats.splits++;
+    } else {
+        put_on_heap(bp, total, 1);
+    }
+    PUT(HDRP(bp), GET(HDRP(bp)) | flags);
+    PUT(FTRP(bp), GET(FTRP(bp)) | flags);
+    stats.bytes_in_use += GET_SIZE(HDRP(bp)) - csize;
+    stats.realloc_inplace++;
+    CAPTURE('r', bp, bp, size);
+    return 1;
+}
+/*$end mmtryexpand*/
+
+/*
+ * mm_usable_size - Payload bytes of the allocated block bp, which may
+ * exceed the size it was requested with
+ */
+/*$begin mmusablesize*/
+size_t mm_usable_size(void *bp)
+{
+    return GET_SIZE(HDRP(bp)) - DSIZE;
+}
+/*$end mmusablesize*/
+
+/*
+ * mm_stats - Copy out the allocator counters. O(1): every counter is
+ * maintained as blocks change state, only the largest free block is
+ * derived, from the highest non-empty size class.
+ */
+/*$begin mmstats*/
+void mm_stats(mm_stats_t *out)
+{
+    int i;
+
+    *out = stats;
+    out->heap_size = mem_heapsize();
+    out->largest_free = 0;
+    for (i = MM_NUM_CLASSES - 1; i >= 0; i--) {
+        if (stats.free_blocks[i] > 0) {
+            out->largest_free = stats.free_bytes[i];
+            if (i < MM_NUM_CLASSES - 1 &&
+                out->largest_free > ((size_t)32 << i) - DSIZE)
+                out->largest_free = ((size_t)32 << i) - DSIZE;
+            break;
+        }
+    }
+}
+/*$end mmstats*/
+
+/*
+ * size_class - Index of the power-of-two size class of a free block
+ */
+/*$begin sizeclass*/
+static int size_class(size_t size)
+{
+    int c = 0;
+
+    size >>= 5;
+    while (size != 0 && c < MM_NUM_CLASSES - 1) {
+        size >>= 1;
+        c++;
+    }
+    return c;
+}
+/*$end sizeclass*/
+
 /* 
  * extend_heap - Extend heap with free block and return its block pointer
  */
@@ -352,15 +1147,19 @@ static void *extend_heap(size_t words)
 {
     char *bp;
     size_t size;
+    int fresh = (char *)mem_heap_hi() + 1 >= (char *)mem_heap_zero();
         
     /* Allocate an even number of words to maintain alignment */
     size = (words % 2) ? (words+1) * WSIZE : words * WSIZE;
     if ((bp = mem_sbrk(size)) == (void *)-1) 
         return NULL;
+    stats.extend_heap_calls++;
 
     /* Initialize free block header/footer and the epilogue header */
     put_on_heap(bp, size, 0); /*put free block header and footer*/
     PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* new epilogue header */
+    if (fresh)
+        mark_zero(bp, bp);  /* never used before: still zero */
 
     /* Coalesce if the previous block was free */
     return coalesce(bp);
@@ -375,21 +1174,52 @@ static void *extend_heap(size_t words)
 static void place(void *bp, size_t asize)
 {
     size_t csize = GET_SIZE(HDRP(bp));   
+    char *z = zero_from(bp);
 
+    remove_block(bp);
     if ((csize - asize) >= (HEAP_SIZE)) { 
         put_on_heap(bp, asize, 1);
-        remove_block(bp);
+        stats.bytes_in_use += asize;
+        stats.splits++;
 	bp = NEXT_BLKP(bp);
 	put_on_heap(bp, csize-asize, 0);
+	mark_zero(bp, z);
        	coalesce(bp);
     }
     else { 
       put_on_heap(bp, csize, 1);
-      remove_block(bp);
+      stats.bytes_in_use += csize;
     }
 }
 /* $end mmplace */
 
+/*
+ * place_high - Place a block of asize bytes at the end of free block
+ * bp, the front staying free if it is at least HEAP_SIZE bytes.
+ * Returns the block placed.
+ */
+/* $begin mmplacehigh */
+static void *place_high(void *bp, size_t asize)
+{
+    size_t csize = GET_SIZE(HDRP(bp));
+    char *z = zero_from(bp);
+
+    if (csize - asize < HEAP_SIZE) {
+        place(bp, asize);
+        return bp;
+    }
+    remove_block(bp);
+    put_on_heap(bp, csize - asize, 0);
+    mark_zero(bp, z);
+    add_block(bp);
+    bp = NEXT_BLKP(bp);
+    put_on_heap(bp, asize, 1);
+    stats.bytes_in_use += asize;
+    stats.splits++;
+    return bp;
+}
+/* $end mmplacehigh */
+
 /* 
  * find_fit - Find a fit for a block with asize bytes 
  */
@@ -408,6 +1238,82 @@ static void *find_fit(size_t asize)
 }
 /*$end findfit*/
 
+/*
+ * find_high_fit - Fit for a short-lived block: the free block at the
+ * highest address that is large enough
+ */
+/*$begin findhighfit*/
+static void *find_high_fit(size_t asize)
+{
+    char *bp, *best = NULL;
+
+#ifdef ADDRESS_ORDERED
+    /* the list is sorted: first fit from its tail, the sentinel's back link */
+    for (bp = BACK_LINK(heap_listp); bp != NULL; bp = BACK_LINK(bp))
+        if (GET_SIZE(HDRP(bp)) >= asize)
+            return bp;
+#else
+    for (bp = FreeListRoot; GET_ALLOC(HDRP(bp)) == 0; bp = FORWARD_LINK(bp))
+        if (GET_SIZE(HDRP(bp)) >= asize && bp > best)
+            best = bp;
+#endif
+    return best;
+}
+/*$end findhighfit*/
+
+/*
+ * find_low_fit - Fit for a long-lived block: the free block at the
+ * lowest address that is large enough
+ */
+/*$begin findlowfit*/
+static void *find_low_fit(size_t asize)
+{
+#ifdef ADDRESS_ORDERED
+    return find_fit(asize);    /* the list is sorted: first fit */
+#else
+    char *bp, *best = NULL;
+
+    for (bp = FreeListRoot; GET_ALLOC(HDRP(bp)) == 0; bp = FORWARD_LINK(bp))
+        if (GET_SIZE(HDRP(bp)) >= asize && (best == NULL || bp < best))
+            best = bp;
+    return best;
+#endif
+}
+/*$end findlowfit*/
+
+/*
+ * aligned_lead - Bytes from bp to the first alignment aligned payload
+ * in its block that leaves room for a free block in front of it
+ */
+/*$begin alignedlead*/
+static size_t aligned_lead(void *bp, size_t alignment)
+{
+    size_t lead = (alignment - (size_t)bp % alignment) % alignment;
+
+    if (lead > 0 && lead < HEAP_SIZE)
+        lead += alignment;
+    return lead;
+}
+/*$end alignedlead*/
+
+/*
+ * find_aligned_fit - First fit for an aligned block of asize bytes;
+ * *lead is set to the slack in front of it
+ */
+/*$begin findalignedfit*/
+static void *find_aligned_fit(size_t alignment, size_t asize, size_t *lead)
+{
+    void *bp;
+
+    for (bp = FreeListRoot; GET_ALLOC(HDRP(bp)) == 0; bp = FORWARD_LINK(bp)) {
+        *lead = aligned_lead(bp, alignment);
+        if (GET_SIZE(HDRP(bp)) >= *lead + asize)
+            return bp;
+    }
+    return NULL;
+}
+/*$end findalignedfit*/
+
 /*
  * coalesce - boundary tag coalescing. Return ptr to coalesced block
  */
@@ -424,35 +1330,42 @@ static void *coalesce(void *bp)
   size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
   size_t size = GET_SIZE(HDRP(bp));
   int flag = 0; //checking if we need to move the pointer we return, to the left (if we extend to the left, as is in Case 2 and Case 3) 
+  char *z = zero_from(bp); /* known zero part of the result */
   
   if (prev_alloc && !next_alloc)                /* Case 1, coalescing with next block  */
   {
       size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
       remove_block(NEXT_BLKP(bp));
+      z = zero_join(bp, NEXT_BLKP(bp), zero_from(NEXT_BLKP(bp)));
       put_on_heap(bp, size, 0);
+      stats.coalesces++;
   }
 
   else if (!prev_alloc && next_alloc)           /* Case 2, coalesing with prev block*/
   {
       flag = 1;
-      size += GET_SIZE(HDRP(PREV_BLKP(bp)));     
-      put_on_heap(PREV_BLKP(bp), size, 0);
-      remove_block(PREV_BLKP(bp));
+      size += GET_SIZE(HDRP(prevBlock));     
+      remove_block(prevBlock);
+      z = zero_join(prevBlock, bp, z);
+      put_on_heap(prevBlock, size, 0);
+      stats.coalesces++;
   }
 
   else if (!prev_alloc && !next_alloc)         /* Case 3, coalesing with both prev and next block*/
   {
       flag = 1;
-      size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(HDRP(NEXT_BLKP(bp)));
-      remove_block(PREV_BLKP(bp));
+      size += GET_SIZE(HDRP(prevBlock)) + GET_SIZE(HDRP(NEXT_BLKP(bp)));
+      remove_block(prevBlock);
       remove_block(NEXT_BLKP(bp));
-      put_on_heap(PREV_BLKP(bp), size, 0);
+      z = zero_join(bp, NEXT_BLKP(bp), zero_from(NEXT_BLKP(bp)));
+      z = zero_join(prevBlock, bp, z);
+      put_on_heap(prevBlock, size, 0);
+      stats.coalesces++;
   }
   if(flag){ //if coalesed with prev block, return prevblock pointer
-    bp = PREV_BLKP(bp);
-    add_block(bp);
-    return bp;
+    bp = prevBlock;
   }
+  mark_zero(bp, z);
   add_block(bp);
   return bp;
 }
@@ -547,6 +1460,14 @@ void mm_checkheap(int verbose)
     printblock(bp);
   if ((GET_SIZE(HDRP(bp)) != 0) || !(GET_ALLOC(HDRP(bp))))
     printf("Bad epilogue header\n");
+#ifdef ADDRESS_ORDERED
+  for (bp = FreeListRoot; GET_ALLOC(HDRP(bp)) == 0; bp = FORWARD_LINK(bp)) {
+    if (!(bm[0][BM_INDEX(bp) / BM_BITS] & 1UL << BM_INDEX(bp) % BM_BITS))
+      printf("Error: free block %p not in the bitmap\n", bp);
+    if (GET_ALLOC(HDRP(FORWARD_LINK(bp))) == 0 && (char *)FORWARD_LINK(bp) < bp)
+      printf("Error: free list out of address order at %p\n", bp);
+  }
+#endif
 }
 /*$end mmcheckheap*/
 
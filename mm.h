@@ -1,9 +1,69 @@
+#ifndef __MM_H_
+#define __MM_H_
+
 #include <stdio.h>
 
 extern int mm_init (void);
 extern void *mm_malloc (size_t size);
+extern void *mm_malloc_hint(size_t size, int hint);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
+extern size_t mm_usable_size(void *ptr);
+extern void mm_free_sized(void *ptr, size_t size);
+extern int mm_try_expand(void *ptr, size_t size);
+extern void *mm_memalign(size_t alignment, size_t size);
+extern void *mm_calloc(size_t nmemb, size_t size);
+extern int mm_malloc_batch(size_t size, int n, void **out);
+extern void mm_free_batch(void **ptrs, int n);
+
+/*
+ * mm_free_sized is an alias of mm_free: the block is freed by its
+ * header, and the size saves no work. The size must be the one ptr was
+ * allocated with (or last grown to by mm_try_expand). That is the
+ * caller's contract: it is only checked by an assert, so with NDEBUG a
+ * wrong size goes unnoticed.
+ */
+
+/*
+ * Lifetime hints of mm_malloc_hint. Short-lived blocks are placed at
+ * the top of the free space, long-lived ones at the bottom; MM_HINT_AUTO
+ * picks short or long from how long earlier blocks of the same size
+ * from the same call site lived. Limits:
+ *  - the call site is mm_malloc_hint's return address only, so all
+ *    the callers of a wrapper around it count as one site;
+ *  - short and long hints scan the whole free list for the highest or
+ *    lowest fit, about 3x the cost of mm_malloc's first fit, unless
+ *    mm.c is built with ADDRESS_ORDERED (the list is then sorted).
+ */
+#define MM_HINT_NONE  0         /* as mm_malloc */
+#define MM_HINT_SHORT 1         /* freed soon */
+#define MM_HINT_LONG  2         /* lives long */
+#define MM_HINT_AUTO  3         /* predicted per call site and size */
+
+/*
+ * Allocator statistics. The counters are kept up to date on the
+ * allocation paths, so mm_stats only copies them out and can be
+ * polled at any time without walking the heap. Free blocks are
+ * counted per power-of-two size class: class i holds the blocks
+ * whose size is in [16 << i, 32 << i), the last class holds the rest.
+ */
+#define MM_NUM_CLASSES 20
+
+typedef struct {
+    size_t bytes_in_use;          /* bytes in allocated blocks (incl. tags) */
+    size_t bytes_free;            /* bytes in free blocks */
+    size_t heap_size;             /* current heap size (mem_heapsize) */
+    size_t free_blocks[MM_NUM_CLASSES]; /* free blocks per size class */
+    size_t free_bytes[MM_NUM_CLASSES];  /* bytes in free blocks per class */
+    size_t largest_free;          /* upper bound on the largest free block */
+    size_t extend_heap_calls;     /* number of times the heap grew */
+    size_t splits;                /* free blocks split by place */
+    size_t coalesces;             /* frees/extensions merged with a neighbour */
+    size_t realloc_inplace;       /* resizes in place (mm_try_expand) */
+    size_t realloc_copy;          /* reallocs that moved their block */
+} mm_stats_t;
+
+extern void mm_stats(mm_stats_t *stats);
 
 
 /* 
@@ -23,3 +83,4 @@ typedef struct {
 
 extern team_t team;
 
+#endif /* __MM_H_ */
@@ -0,0 +1,138 @@
+/*
+ * mmarena.c - Arenas of bump allocated chunks (see mmarena.h)
+ *
+ * The chunks of an arena form a list in the order they were first
+ * used; the arena itself lives at the start of the first one. cur is
+ * the chunk being filled and [ptr, end) its free part. When a request
+ * does not fit, the arena moves on to the next chunk of the list that
+ * can hold it (after a reset, the chunks of earlier rounds), and only
+ * at the end of the list asks mm_malloc for a new one. A reset just
+ * points cur back at the first chunk.
+ */
+#include "mm.h"
+#include "mmarena.h"
+#include "config.h"
+
+#define ARENA_ALIGN   8               /* alignment of the objects */
+#define DEFAULT_CHUNK (64*1024)       /* default storage of a chunk */
+
+#define ROUND(n)      (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define MAX(x, y)     ((x) > (y) ? (x) : (y))
+
+/* A chunk: this header, then its storage up to end */
+typedef struct chunk {
+    struct chunk *next;     /* next chunk of the arena */
+    char *end;              /* end of the storage */
+} chunk_t;
+
+#define DATA(c)       ((char *)(c) + ROUND(sizeof(chunk_t)))
+
+/* The most storage a chunk can have: the heap, less the header. Sizes
+   are checked against it before they are rounded, which could wrap. */
+#define MAX_CHUNK     (MAX_HEAP - ROUND(sizeof(chunk_t)))
+
+struct mm_arena {
+    chunk_t *first;         /* the chunk holding the arena */
+    chunk_t *cur;           /* the chunk being filled */
+    char *ptr;              /* next free byte of cur */
+    char *end;              /* end of cur */
+    size_t chunk_size;      /* storage of a new chunk */
+};
+
+/*
+ * new_chunk - A chunk with bytes of storage, from mm_malloc
+ */
+static chunk_t *new_chunk(size_t bytes)
+{
+    chunk_t *c;
+
+    if ((c = mm_malloc(ROUND(sizeof(chunk_t)) + bytes)) == NULL)
+	return NULL;
+    c->next = NULL;
+    c->end = DATA(c) + bytes;
+    return c;
+}
+
+/*
+ * mm_arena_create - The arena in its first chunk
+ */
+mm_arena_t *mm_arena_create(size_t chunk_size)
+{
+    mm_arena_t *arena;
+    chunk_t *c;
+
+    if (chunk_size > MAX_CHUNK - ROUND(sizeof(mm_arena_t)))
+	return NULL;
+    chunk_size = ROUND(chunk_size ? chunk_size : DEFAULT_CHUNK);
+    if ((c = new_chunk(ROUND(sizeof(mm_arena_t)) + chunk_size)) == NULL)
+	return NULL;
+    arena = (mm_arena_t *)DATA(c);
+    arena->first = c;
+    arena->chunk_size = chunk_size;
+    mm_arena_reset(arena);
+    return arena;
+}
+
+/*
+ * alloc_slow - size bytes from the next chunk that has room for them,
+ *     or from a new one at the end of the list
+ */
+static void *alloc_slow(mm_arena_t *arena, size_t size)
+{
+    chunk_t *c, *last = arena->cur;
+
+    for (c = arena->cur->next; c != NULL; c = c->next) {
+	if ((size_t)(c->end - DATA(c)) >= size)
+	    break;
+	last = c;
+    }
+    if (c == NULL) {
+	if ((c = new_chunk(MAX(size, arena->chunk_size))) == NULL)
+	    return NULL;
+	last->next = c;
+    }
+    arena->cur = c;
+    arena->ptr = DATA(c) + size;
+    arena->end = c->end;
+    return DATA(c);
+}
+
+/*
+ * mm_arena_alloc - Bump the pointer of the current chunk
+ */
+void *mm_arena_alloc(mm_arena_t *arena, size_t size)
+{
+    char *p = arena->ptr;
+
+    if (size == 0 || size > MAX_CHUNK)
+	return NULL;
+    size = ROUND(size);
+    if ((size_t)(arena->end - p) < size)
+	return alloc_slow(arena, size);
+    arena->ptr = p + size;
+    return p;
+}
+
+/*
+ * mm_arena_reset - Rewind to the start of the first chunk
+ */
+void mm_arena_reset(mm_arena_t *arena)
+{
+    arena->cur = arena->first;
+    arena->ptr = DATA(arena->first) + ROUND(sizeof(mm_arena_t));
+    arena->end = arena->first->end;
+}
+
+/*
+ * mm_arena_destroy - Free the chunks, the first (holding arena) last
+ */
+void mm_arena_destroy(mm_arena_t *arena)
+{
+    chunk_t *first = arena->first, *c, *next;
+
+    for (c = first->next; c != NULL; c = next) {
+	next = c->next;
+	mm_free(c);
+    }
+    mm_free(first);
+}
@@ -0,0 +1,42 @@
+/*
+ * mmarena.h - Arenas: bump allocation in chunks from mm_malloc,
+ *     released all at once
+ *
+ * Objects that die together (e.g. everything allocated while serving
+ * one request) are allocated from an arena by moving a pointer
+ * through the current chunk, and are never freed one by one:
+ * mm_arena_reset releases them all in constant time by rewinding the
+ * arena to its first chunk. The chunks are kept and refilled after a
+ * reset, so an arena that has warmed up no longer calls mm_malloc.
+ * Only mm_arena_destroy gives the chunks back to the heap.
+ */
+#ifndef __MMARENA_H_
+#define __MMARENA_H_
+
+#include <stddef.h>
+
+typedef struct mm_arena mm_arena_t;
+
+/*
+ * mm_arena_create - New arena growing by chunks of chunk_size bytes
+ *     (0 for a default of 64 KB). The heap must be initialized (mm_init).
+ *     Returns NULL if a chunk would be larger than the heap or there
+ *     is no memory.
+ */
+mm_arena_t *mm_arena_create(size_t chunk_size);
+
+/*
+ * mm_arena_alloc - size bytes, 8-byte aligned, valid until the next
+ *     reset. Larger requests than fit in a chunk get a chunk of their
+ *     own. Returns NULL if size is 0, larger than the heap, or there
+ *     is no memory.
+ */
+void *mm_arena_alloc(mm_arena_t *arena, size_t size);
+
+/* mm_arena_reset - Release everything allocated from arena, in O(1) */
+void mm_arena_reset(mm_arena_t *arena);
+
+/* mm_arena_destroy - Release arena and return its chunks to the heap */
+void mm_arena_destroy(mm_arena_t *arena);
+
+#endif /* __MMARENA_H_ */
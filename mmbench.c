@@ -0,0 +1,409 @@
+/*
+ * mmbench.c - Microbenchmarks of the internal routines of mm.c
+ *
+ * mm.c is included rather than linked, so that its static helpers
+ * (find_fit, place, coalesce, add_block, remove_block, extend_heap)
+ * can be called directly. Each benchmark builds a heap with a known
+ * shape, times a batch of calls of one routine with both the
+ * monotonic clock and the cycle counter of clock.c, and restores the
+ * heap outside of the timed region before the next round, so that
+ * every timed call sees the same state.
+ *
+ * The heaps are built from free blocks separated by allocated 24 byte
+ * guard blocks, so that the length of the free list and the size of
+ * the blocks on it are controlled exactly:
+ *
+ *   find_fit     a list of L free 24 byte holes in front of the
+ *                wilderness block: a hit at the head, a hit at the
+ *                tail (after L blocks) and a miss (all of L + 1)
+ *   add/remove   K listed blocks removed from and put back on the list
+ *   place        K free blocks of exactly the request (no split) or of
+ *                twice the request (split)
+ *   coalesce     K free-tagged blocks in each of the four neighbour
+ *                cases of coalesce
+ *   extend_heap  K extensions of a heap ending in a free block
+ *   batch        K mm_malloc then K mm_free calls, against one
+ *                mm_malloc_batch and one mm_free_batch of K blocks
+ *   arena        K mm_arena_alloc calls and one mm_arena_reset
+ *   pool         K mm_pool_alloc and K mm_pool_free calls
+ *
+ * usage: mmbench [-h] [-r <rounds>] [-k <batch>]
+ */
+#include <time.h>
+#include <getopt.h>
+
+#include "mm.c"
+#include "mmarena.h"
+#include "mmpool.h"
+#include "clock.h"
+#include "config.h"
+
+#define MAXK 4096                /* largest batch of blocks */
+
+static int rounds = 50;          /* -r: rounds of each benchmark */
+static int batch = 1024;         /* -k: calls timed per round */
+
+static void *blocks[MAXK];       /* the blocks under test */
+static void *prevs[MAXK];        /* their left neighbours (coalesce) */
+static void *nexts[MAXK];        /* their right neighbours (coalesce) */
+static volatile size_t sink;     /* keeps results alive */
+
+/* Time and cycles accumulated for the current benchmark */
+static double acc_ns, acc_cyc, acc_ops, t0;
+
+static void usage(void);
+
+/*
+ * now_ns - Monotonic time in ns
+ */
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * tic/toc - Time the calls between them; toc adds ops calls
+ */
+static void tic(void)
+{
+    t0 = now_ns();
+    start_counter();
+}
+
+static void toc(int ops)
+{
+    acc_cyc += get_counter();
+    acc_ns += now_ns() - t0;
+    acc_ops += ops;
+}
+
+/*
+ * report - Print and reset the per-call cost of the current benchmark
+ */
+static void report(const char *name, int param)
+{
+    char label[64];
+
+    if (param >= 0)
+	snprintf(label, sizeof(label), "%s (%d)", name, param);
+    else
+	snprintf(label, sizeof(label), "%s", name);
+    printf("%-32s %10.1f %10.1f\n", label, acc_ns / acc_ops,
+	   acc_cyc / acc_ops);
+    acc_ns = acc_cyc = acc_ops = 0;
+}
+
+/*
+ * new_heap - Start again from an empty heap whose free block has room
+ *     for bytes more, so that the blocks carved from it are contiguous
+ *     and of exactly the size asked for
+ */
+static void new_heap(size_t bytes)
+{
+    mem_reset_brk();
+    if (mm_init() < 0 ||
+	(bytes > 0 && extend_heap((bytes + CHUNKSIZE) / WSIZE) == NULL)) {
+	fprintf(stderr, "mmbench: cannot set up the heap\n");
+	exit(1);
+    }
+}
+
+/*
+ * build_holes - New heap with n blocks of size bytes (tags included),
+ *     each followed by an allocated guard block, freed if listed is
+ *     set. blocks[] holds the block pointers.
+ */
+static void build_holes(int n, size_t size, int listed)
+{
+    int i;
+
+    new_heap(n * (size + HEAP_SIZE));
+    for (i = 0; i < n; i++) {
+	blocks[i] = mm_malloc(size - DSIZE);
+	mm_malloc(HEAP_SIZE - DSIZE);
+    }
+    if (listed)
+	for (i = 0; i < n; i++)
+	    mm_free(blocks[i]);
+}
+
+/*
+ * bench_find_fit - First fit over a list of len 24 byte holes
+ */
+static void bench_find_fit(int len)
+{
+    int iters = 4000000 / (len + 1), r, i;
+
+    if (iters < 1000)
+	iters = 1000;
+    build_holes(len, HEAP_SIZE, 1);
+
+    for (r = 0; r < rounds; r++) {
+	tic();
+	for (i = 0; i < iters; i++)
+	    sink += (size_t)find_fit(HEAP_SIZE);
+	toc(iters);
+    }
+    report("find_fit head hit", len);
+
+    for (r = 0; r < rounds; r++) {
+	tic();
+	for (i = 0; i < iters; i++)
+	    sink += (size_t)find_fit(2 * HEAP_SIZE);
+	toc(iters);
+    }
+    report("find_fit tail hit", len);
+
+    for (r = 0; r < rounds; r++) {
+	tic();
+	for (i = 0; i < iters; i++)
+	    sink += (size_t)find_fit(MAX_HEAP);
+	toc(iters);
+    }
+    report("find_fit miss", len);
+}
+
+/*
+ * bench_list - remove_block and add_block of listed blocks
+ */
+static void bench_list(void)
+{
+    double ns = 0, cyc = 0, ops = 0;
+    int r, i;
+
+    build_holes(batch, HEAP_SIZE, 1);
+    for (r = 0; r < rounds; r++) {
+	tic();
+	for (i = 0; i < batch; i++)
+	    remove_block(blocks[i]);
+	toc(batch);
+	ns += acc_ns;
+	cyc += acc_cyc;
+	ops += acc_ops;
+	acc_ns = acc_cyc = acc_ops = 0;
+
+	tic();
+	for (i = 0; i < batch; i++)
+	    add_block(blocks[i]);
+	toc(batch);
+    }
+    report("add_block", -1);
+    acc_ns = ns;
+    acc_cyc = cyc;
+    acc_ops = ops;
+    report("remove_block", -1);
+}
+
+/*
+ * bench_place - place of a request of asize bytes into free blocks of
+ *     size bytes
+ */
+static void bench_place(const char *name, size_t size, size_t asize)
+{
+    int r, i;
+
+    build_holes(batch, size, 1);
+    for (r = 0; r < rounds; r++) {
+	tic();
+	for (i = 0; i < batch; i++)
+	    place(blocks[i], asize);
+	toc(batch);
+	for (i = 0; i < batch; i++)
+	    mm_free(blocks[i]);
+    }
+    report(name, (int)(size - asize));
+}
+
+/*
+ * bench_coalesce - coalesce of blocks whose left (prev_free) and
+ *     right (next_free) neighbours are free or allocated
+ */
+static void bench_coalesce(int which, int prev_free, int next_free)
+{
+    int r, i;
+
+    new_heap((size_t)batch * 4 * HEAP_SIZE);
+    for (i = 0; i < batch; i++) {
+	prevs[i] = mm_malloc(HEAP_SIZE - DSIZE);
+	blocks[i] = mm_malloc(HEAP_SIZE - DSIZE);
+	nexts[i] = mm_malloc(HEAP_SIZE - DSIZE);
+	mm_malloc(HEAP_SIZE - DSIZE);
+    }
+    for (r = 0; r < rounds; r++) {
+	for (i = 0; i < batch; i++) {
+	    if (prev_free)
+		mm_free(prevs[i]);
+	    if (next_free)
+		mm_free(nexts[i]);
+	    put_on_heap(blocks[i], HEAP_SIZE, 0);
+	}
+	tic();
+	for (i = 0; i < batch; i++)
+	    sink += (size_t)coalesce(blocks[i]);
+	toc(batch);
+	for (i = 0; i < batch; i++) {
+	    remove_block(prev_free ? prevs[i] : blocks[i]);
+	    put_on_heap(prevs[i], HEAP_SIZE, 1);
+	    put_on_heap(blocks[i], HEAP_SIZE, 1);
+	    put_on_heap(nexts[i], HEAP_SIZE, 1);
+	}
+    }
+    report("coalesce case", which);
+}
+
+/*
+ * bench_extend_heap - Grow a heap that ends in a free block
+ */
+static void bench_extend_heap(void)
+{
+    int n = batch, r, i;
+
+    if ((size_t)n * CHUNKSIZE > MAX_HEAP / 2)
+	n = MAX_HEAP / 2 / CHUNKSIZE;
+    for (r = 0; r < rounds; r++) {
+	new_heap(0);
+	tic();
+	for (i = 0; i < n; i++)
+	    sink += (size_t)extend_heap(CHUNKSIZE / WSIZE);
+	toc(n);
+    }
+    report("extend_heap", CHUNKSIZE);
+}
+
+/*
+ * bench_batch - Per block cost of allocating and freeing batch blocks
+ *     of size bytes one by one and with the batch calls
+ */
+static void bench_batch(size_t size)
+{
+    int r, i;
+
+    new_heap((size_t)batch * (size + HEAP_SIZE));
+    for (r = 0; r < rounds; r++) {
+	tic();
+	for (i = 0; i < batch; i++)
+	    blocks[i] = mm_malloc(size);
+	for (i = 0; i < batch; i++)
+	    mm_free(blocks[i]);
+	toc(batch);
+    }
+    report("malloc+free", (int)size);
+
+    for (r = 0; r < rounds; r++) {
+	tic();
+	mm_malloc_batch(size, batch, blocks);
+	mm_free_batch(blocks, batch);
+	toc(batch);
+    }
+    report("malloc_batch+free_batch", (int)size);
+}
+
+/*
+ * bench_arena - Per object cost of batch arena allocations and the
+ *     reset that releases them
+ */
+static void bench_arena(size_t size)
+{
+    mm_arena_t *arena;
+    int r, i;
+
+    new_heap(0);
+    if ((arena = mm_arena_create(0)) == NULL) {
+	fprintf(stderr, "mmbench: cannot create an arena\n");
+	exit(1);
+    }
+    for (r = 0; r < rounds; r++) {
+	tic();
+	for (i = 0; i < batch; i++)
+	    blocks[i] = mm_arena_alloc(arena, size);
+	mm_arena_reset(arena);
+	toc(batch);
+    }
+    report("arena_alloc+reset", (int)size);
+    mm_arena_destroy(arena);
+}
+
+/*
+ * bench_pool - Per object cost of allocating batch objects of size
+ *     bytes from a pool and freeing them
+ */
+static void bench_pool(size_t size)
+{
+    mm_pool_t *pool;
+    int r, i;
+
+    new_heap(0);
+    if ((pool = mm_pool_create(size, 0)) == NULL) {
+	fprintf(stderr, "mmbench: cannot create a pool\n");
+	exit(1);
+    }
+    for (r = 0; r < rounds; r++) {
+	tic();
+	for (i = 0; i < batch; i++)
+	    blocks[i] = mm_pool_alloc(pool);
+	for (i = 0; i < batch; i++)
+	    mm_pool_free(pool, blocks[i]);
+	toc(batch);
+    }
+    report("pool_alloc+free", (int)size);
+    mm_pool_destroy(pool);
+}
+
+int main(int argc, char **argv)
+{
+    static const int lens[] = { 1, 16, 256, 4096 };
+    int c, i;
+
+    while ((c = getopt(argc, argv, "hr:k:")) != EOF) {
+	switch (c) {
+	case 'r':
+	    rounds = atoi(optarg);
+	    break;
+	case 'k':
+	    batch = atoi(optarg);
+	    break;
+	case 'h':
+	default:
+	    usage();
+	    exit(c == 'h' ? 0 : 1);
+	}
+    }
+    if (rounds <= 0 || batch <= 0 || batch > MAXK) {
+	usage();
+	exit(1);
+    }
+
+    mem_init();
+    printf("%-32s %10s %10s\n", "routine", "ns/op", "cycles/op");
+    for (i = 0; i < (int)(sizeof(lens) / sizeof(lens[0])); i++)
+	bench_find_fit(lens[i]);
+    bench_list();
+    bench_place("place no split", 2 * HEAP_SIZE, 2 * HEAP_SIZE);
+    bench_place("place split", 4 * HEAP_SIZE, 2 * HEAP_SIZE);
+    bench_coalesce(0, 0, 0);
+    bench_coalesce(1, 0, 1);
+    bench_coalesce(2, 1, 0);
+    bench_coalesce(3, 1, 1);
+    bench_extend_heap();
+    bench_batch(64);
+    bench_arena(64);
+    bench_pool(64);
+    mem_deinit();
+    return (int)(sink & 0);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mmbench [-h] [-r <rounds>] [-k <batch>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h          Print this message.\n");
+    fprintf(stderr, "\t-k <batch>  Calls timed per round, at most %d (default 1024).\n",
+	    MAXK);
+    fprintf(stderr, "\t-r <rounds> Rounds of each benchmark (default 50).\n");
+}
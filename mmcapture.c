@@ -0,0 +1,195 @@
+/*
+ * mmcapture.c - Lock-free capture of allocator events
+ *
+ * Every thread that calls the allocator while capture is on gets a
+ * ring of RING_EVENTS records, mapped straight from the OS and pushed
+ * onto a global list with a compare-and-swap. The thread is the only
+ * writer of its ring's head, the writer thread the only writer of its
+ * tail, so producer and consumer synchronize with one release store
+ * each and never take a lock. Rings outlive their threads: the writer
+ * keeps draining them and they are reused by the next capture.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "mmcapture.h"
+
+#define RING_EVENTS (1<<14)          /* records per thread, power of 2 */
+#define WRITER_SLEEP_NS 1000000      /* writer idles 1 ms when all are empty */
+
+typedef struct ring {
+    struct ring *next;               /* global list of rings */
+    unsigned long head;              /* next slot to fill (producer) */
+    unsigned long tail;              /* next slot to drain (writer) */
+    unsigned long dropped;           /* events lost on a full ring */
+    unsigned short id;
+    cap_event_t events[RING_EVENTS];
+} ring_t;
+
+volatile int capture_on = 0;
+__thread int capture_quiet = 0;
+
+static __thread ring_t *my_ring;     /* this thread's ring */
+static ring_t *rings;                /* all rings ever registered */
+static unsigned short ring_count;
+static FILE *capture_fp;
+static pthread_t writer;
+static volatile int writer_running;
+
+/*
+ * read_tsc - Cheap timestamp: the cycle counter where there is one
+ */
+static unsigned long long read_tsc(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/*
+ * ring_register - Map a ring for the calling thread and publish it
+ */
+static ring_t *ring_register(void)
+{
+    ring_t *r;
+
+    r = mmap(NULL, sizeof(ring_t), PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (r == MAP_FAILED)
+	return NULL;
+    r->id = __atomic_fetch_add(&ring_count, 1, __ATOMIC_RELAXED);
+    r->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&rings, &r->next, r, 1,
+					__ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	;
+    my_ring = r;
+    return r;
+}
+
+/*
+ * capture_event - Append one event to the calling thread's ring
+ */
+void capture_event(char op, void *addr, void *old, size_t size)
+{
+    ring_t *r = my_ring;
+    unsigned long head, tail;
+    cap_event_t *e;
+
+    if (r == NULL && (r = ring_register()) == NULL)
+	return;
+    head = r->head;
+    tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= RING_EVENTS) {
+	r->dropped++;
+	return;
+    }
+    e = &r->events[head & (RING_EVENTS - 1)];
+    e->tsc = read_tsc();
+    e->addr = (unsigned long)addr;
+    e->old = (unsigned long)old;
+    e->size = (unsigned int)size;
+    e->thread = r->id;
+    e->op = op;
+    e->pad = 0;
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * drain - Write out everything the rings hold. Returns the number of
+ *     events written.
+ */
+static unsigned long drain(void)
+{
+    ring_t *r;
+    unsigned long head, tail, n, total = 0;
+
+    for (r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+	head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	tail = r->tail;
+	while (tail != head) {
+	    /* contiguous run up to the end of the ring or to head */
+	    n = RING_EVENTS - (tail & (RING_EVENTS - 1));
+	    if (n > head - tail)
+		n = head - tail;
+	    fwrite(&r->events[tail & (RING_EVENTS - 1)], sizeof(cap_event_t),
+		   n, capture_fp);
+	    tail += n;
+	    total += n;
+	}
+	__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+    }
+    return total;
+}
+
+/*
+ * writer_main - Background thread draining the rings to disk
+ */
+static void *writer_main(void *arg)
+{
+    struct timespec idle = { 0, WRITER_SLEEP_NS };
+
+    (void)arg;
+    while (writer_running) {
+	if (drain() == 0)
+	    nanosleep(&idle, NULL);
+    }
+    return NULL;
+}
+
+/*
+ * mm_capture_start - Open the capture file and start the writer
+ */
+int mm_capture_start(const char *path)
+{
+    ring_t *r;
+
+    if (capture_on)
+	return -1;
+    if ((capture_fp = fopen(path, "wb")) == NULL)
+	return -1;
+    fwrite(CAP_MAGIC, 1, strlen(CAP_MAGIC), capture_fp);
+
+    /* rings left over from an earlier capture start out empty */
+    for (r = rings; r != NULL; r = r->next) {
+	r->tail = r->head;
+	r->dropped = 0;
+    }
+    writer_running = 1;
+    if (pthread_create(&writer, NULL, writer_main, NULL) != 0) {
+	fclose(capture_fp);
+	capture_fp = NULL;
+	return -1;
+    }
+    capture_on = 1;
+    return 0;
+}
+
+/*
+ * mm_capture_stop - Stop the writer, flush the rings, close the file
+ */
+unsigned long mm_capture_stop(void)
+{
+    unsigned long dropped = 0;
+    ring_t *r;
+
+    if (!capture_on)
+	return 0;
+    capture_on = 0;
+    writer_running = 0;
+    pthread_join(writer, NULL);
+    drain();
+    fclose(capture_fp);
+    capture_fp = NULL;
+
+    for (r = rings; r != NULL; r = r->next)
+	dropped += r->dropped;
+    return dropped;
+}
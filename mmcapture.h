@@ -0,0 +1,55 @@
+/*
+ * mmcapture.h - record every mm_malloc/mm_free/mm_realloc to a file
+ *
+ * While capture is on, each allocator call appends a fixed-size
+ * record to a ring buffer owned by the calling thread. The rings are
+ * single-producer/single-consumer and lock-free: the only consumer is
+ * a background writer thread that drains them to the capture file.
+ * When a ring is full the event is dropped and counted rather than
+ * stalling the allocator. cap2rep turns a capture file into a .rep
+ * trace for the driver.
+ */
+#ifndef __MMCAPTURE_H_
+#define __MMCAPTURE_H_
+
+#include <stddef.h>
+
+/* Capture file magic, followed by cap_event_t records */
+#define CAP_MAGIC "MMCAP01\n"
+
+/* One allocator event as stored in the capture file */
+typedef struct {
+    unsigned long long tsc;   /* time stamp counter when the call returned */
+    unsigned long long addr;  /* block returned (a, r) or freed (f) */
+    unsigned long long old;   /* r: block that was resized, else 0 */
+    unsigned int size;        /* requested size (a, r) */
+    unsigned short thread;    /* capture's index of the calling thread */
+    char op;                  /* 'a', 'f' or 'r' */
+    char pad;
+} cap_event_t;
+
+/*
+ * mm_capture_start - Start capturing to path. Returns 0, or -1 if the
+ *     file or the writer thread could not be created.
+ */
+int mm_capture_start(const char *path);
+
+/*
+ * mm_capture_stop - Stop capturing, drain all rings and close the
+ *     file. Returns the number of events dropped on full rings.
+ */
+unsigned long mm_capture_stop(void);
+
+/* Hooks used by mm.c */
+extern volatile int capture_on;       /* nonzero while capturing */
+extern __thread int capture_quiet;    /* nonzero inside mm_realloc */
+
+void capture_event(char op, void *addr, void *old, size_t size);
+
+#define CAPTURE(op, addr, old, size) \
+    do { \
+	if (capture_on && !capture_quiet) \
+	    capture_event(op, addr, old, size); \
+    } while (0)
+
+#endif /* __MMCAPTURE_H_ */
@@ -0,0 +1,235 @@
+/*
+ * mmpmr.hpp - C++ allocator adapters for mm.c (C++17)
+ *
+ * Routes chosen containers through the allocator without replacing
+ * the global malloc:
+ *
+ *   mm::allocator<T>       stateless std::allocator replacement, e.g.
+ *                          std::vector<int, mm::allocator<int>>
+ *   mm::heap_resource()    std::pmr::memory_resource on mm_malloc
+ *   mm::arena_resource     monotonic resource on an mm_arena_t:
+ *                          deallocate is a no-op, release() frees all
+ *   mm::pool_resource      resource on an mm_pool_t for one object
+ *                          size; other requests go to an upstream
+ *
+ * Every allocation passes its size back when it is freed, so blocks
+ * are released with mm_free_sized. Alignments above 8 bytes go to
+ * mm_memalign. Out of memory throws std::bad_alloc, or aborts when
+ * built without exceptions (as the Makefile does).
+ *
+ * mm.c is not thread safe: the heap must be set up (mem_init, mm_init)
+ * before the first allocation and used from one thread at a time.
+ */
+#ifndef __MMPMR_HPP_
+#define __MMPMR_HPP_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <memory_resource>
+
+extern "C" {
+#include "mm.h"
+#include "mmarena.h"
+#include "mmpool.h"
+}
+
+namespace mm {
+
+constexpr std::size_t ALIGNMENT = 8;    /* alignment of mm_malloc */
+
+[[noreturn]] inline void out_of_memory()
+{
+#if defined(__cpp_exceptions)
+    throw std::bad_alloc();
+#else
+    std::abort();
+#endif
+}
+
+/*
+ * allocate - bytes aligned to align from the heap (a zero byte request
+ *     still gets a block of its own)
+ */
+inline void *allocate(std::size_t bytes, std::size_t align)
+{
+    void *p;
+
+    if (bytes == 0)
+	bytes = 1;
+    if (align > ALIGNMENT)
+	p = mm_memalign(align, bytes);
+    else
+	p = mm_malloc(bytes);
+    if (p == nullptr)
+	out_of_memory();
+    return p;
+}
+
+inline void deallocate(void *p, std::size_t bytes) noexcept
+{
+    mm_free_sized(p, bytes ? bytes : 1);
+}
+
+/*
+ * allocator - Stateless allocator: all instances share the one heap
+ *     and compare equal
+ */
+template <typename T>
+struct allocator {
+    using value_type = T;
+
+    allocator() noexcept = default;
+    template <typename U>
+    allocator(const allocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n)
+    {
+	if (n > std::size_t(-1) / sizeof(T))
+	    out_of_memory();
+	return static_cast<T *>(mm::allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+	mm::deallocate(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const allocator<T> &, const allocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const allocator<T> &, const allocator<U> &) { return false; }
+
+/*
+ * resource - memory_resource on mm_malloc/mm_free_sized. Use the one
+ *     returned by heap_resource().
+ */
+class resource : public std::pmr::memory_resource {
+    void *do_allocate(std::size_t bytes, std::size_t align) override
+    {
+	return mm::allocate(bytes, align);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t) override
+    {
+	mm::deallocate(p, bytes);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other)
+	const noexcept override
+    {
+	return this == &other;
+    }
+};
+
+inline std::pmr::memory_resource *heap_resource()
+{
+    static resource heap;
+    return &heap;
+}
+
+/*
+ * arena_resource - Monotonic resource: memory is only given back by
+ *     release() (all of it, in O(1)) or the destructor. Chunks are of
+ *     chunk_size bytes, 0 for mm_arena_create's default.
+ */
+class arena_resource : public std::pmr::memory_resource {
+public:
+    explicit arena_resource(std::size_t chunk_size = 0)
+	: arena_(mm_arena_create(chunk_size))
+    {
+	if (arena_ == nullptr)
+	    out_of_memory();
+    }
+    ~arena_resource() { mm_arena_destroy(arena_); }
+    arena_resource(const arena_resource &) = delete;
+    arena_resource &operator=(const arena_resource &) = delete;
+
+    void release() { mm_arena_reset(arena_); }
+
+private:
+    mm_arena_t *arena_;
+
+    /* The arena aligns to 8: pad for larger alignments and round up */
+    void *do_allocate(std::size_t bytes, std::size_t align) override
+    {
+	std::size_t pad = align > ALIGNMENT ? align - ALIGNMENT : 0;
+	char *p = static_cast<char *>(mm_arena_alloc(arena_,
+						     (bytes ? bytes : 1) + pad));
+
+	if (p == nullptr)
+	    out_of_memory();
+	return reinterpret_cast<void *>((reinterpret_cast<std::size_t>(p) + pad) &
+					~(align - 1));
+    }
+
+    void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other)
+	const noexcept override
+    {
+	return this == &other;
+    }
+};
+
+/*
+ * pool_resource - Resource for objects of up to obj_size bytes aligned
+ *     to at most align (0 for 8), e.g. the nodes of a list or map,
+ *     served by an mm_pool_t. Larger or more aligned requests (a
+ *     map's bucket array) go to upstream.
+ */
+class pool_resource : public std::pmr::memory_resource {
+public:
+    pool_resource(std::size_t obj_size, std::size_t align = 0,
+		  std::pmr::memory_resource *upstream = heap_resource())
+	: pool_(mm_pool_create(obj_size, align)), size_(obj_size),
+	  align_(align > ALIGNMENT ? align : ALIGNMENT), upstream_(upstream)
+    {
+	if (pool_ == nullptr)
+	    out_of_memory();
+    }
+    ~pool_resource() { mm_pool_destroy(pool_); }
+    pool_resource(const pool_resource &) = delete;
+    pool_resource &operator=(const pool_resource &) = delete;
+
+private:
+    mm_pool_t *pool_;
+    std::size_t size_;
+    std::size_t align_;
+    std::pmr::memory_resource *upstream_;
+
+    bool pooled(std::size_t bytes, std::size_t align) const
+    {
+	return bytes <= size_ && align <= align_;
+    }
+
+    void *do_allocate(std::size_t bytes, std::size_t align) override
+    {
+	void *p;
+
+	if (!pooled(bytes, align))
+	    return upstream_->allocate(bytes, align);
+	if ((p = mm_pool_alloc(pool_)) == nullptr)
+	    out_of_memory();
+	return p;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t align) override
+    {
+	if (pooled(bytes, align))
+	    mm_pool_free(pool_, p);
+	else
+	    upstream_->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other)
+	const noexcept override
+    {
+	return this == &other;
+    }
+};
+
+} // namespace mm
+
+#endif /* __MMPMR_HPP_ */
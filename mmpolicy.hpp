@@ -0,0 +1,525 @@
+/*
+ * mmpolicy.hpp - Allocator core parameterised by policies (C++17)
+ *
+ * mm.c and mm-firstfit.c share the boundary tag macro layer and only
+ * differ in how free blocks are kept and found. Here that layer is
+ * written once and the differences are template parameters:
+ *
+ *   Layout<Word, Footers>  tag width (uint32_t or uint64_t) and
+ *                          whether allocated blocks keep a footer.
+ *                          Free blocks always have one; a prev-alloc
+ *                          bit in each header tells coalesce whether
+ *                          it may read the previous block's footer.
+ *   FreeList               Implicit, ExplicitLifo, AddressOrdered or
+ *                          Segregated<N>::List (N power-of-two classes)
+ *   Fit                    FirstFit, NextFit or BestFit
+ *   Growth                 FixedChunk<bytes> or Geometric<min, num, den>
+ *
+ * Every choice is resolved at compile time (templates, if constexpr
+ * and constexpr constants), so an instance contains only the code of
+ * its own policies: no function pointers and no run-time tests of the
+ * configuration on the allocation paths.
+ *
+ * The heap comes from memlib, like mm.c's. Instances are registered
+ * for the tools in mm-policy.cpp.
+ */
+#ifndef __MMPOLICY_HPP_
+#define __MMPOLICY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+extern "C" {
+#include "memlib.h"
+}
+
+namespace mmpolicy {
+
+constexpr std::size_t ALIGNMENT = 8;
+
+constexpr std::size_t align_up(std::size_t n)
+{
+    return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+/*
+ * Layout - Boundary tags of Word bytes: size | prev-alloc | alloc.
+ *     A block pointer bp points at the payload; its header is the
+ *     word before it and its footer (if any) the last word of the
+ *     block.
+ */
+template <typename Word, bool Footers>
+struct Layout {
+    using word_t = Word;
+    static constexpr std::size_t W = sizeof(Word);
+    static constexpr Word ALLOC = 1;
+    static constexpr Word PREV_ALLOC = 2;
+    static constexpr Word SIZE_MASK = ~Word(7);
+    static constexpr std::size_t OVERHEAD = Footers ? 2 * W : W;
+
+    static Word &hdr(char *bp) { return *reinterpret_cast<Word *>(bp - W); }
+    static Word &ftr(char *bp)
+    {
+	return *reinterpret_cast<Word *>(bp + size(bp) - 2 * W);
+    }
+    static std::size_t size(char *bp) { return hdr(bp) & SIZE_MASK; }
+    static bool alloc(char *bp) { return hdr(bp) & ALLOC; }
+    static bool prev_alloc(char *bp) { return hdr(bp) & PREV_ALLOC; }
+    static char *next(char *bp) { return bp + size(bp); }
+
+    /* Only valid when !prev_alloc(bp): read the previous footer */
+    static char *prev(char *bp)
+    {
+	return bp - (*reinterpret_cast<Word *>(bp - 2 * W) & SIZE_MASK);
+    }
+
+    /*
+     * set - Tag bp as an Alloc block of size bytes, keeping its own
+     *     prev-alloc bit and updating the next block's
+     */
+    template <bool Alloc>
+    static void set(char *bp, std::size_t size)
+    {
+	hdr(bp) = Word(size) | (hdr(bp) & PREV_ALLOC) | (Alloc ? ALLOC : 0);
+	if constexpr (!Alloc || Footers)
+	    ftr(bp) = hdr(bp);
+	if constexpr (Alloc)
+	    hdr(next(bp)) |= PREV_ALLOC;
+	else
+	    hdr(next(bp)) &= ~PREV_ALLOC;
+    }
+};
+
+/* The links of explicit lists, kept in the payload of free blocks */
+struct Links {
+    static char *&succ(char *bp) { return *reinterpret_cast<char **>(bp); }
+    static char *&pred(char *bp)
+    {
+	return *reinterpret_cast<char **>(bp + sizeof(char *));
+    }
+
+    static void push(char *&head, char *bp)
+    {
+	succ(bp) = head;
+	pred(bp) = nullptr;
+	if (head)
+	    pred(head) = bp;
+	head = bp;
+    }
+
+    static void unlink(char *&head, char *bp)
+    {
+	char *s = succ(bp), *p = pred(bp);
+
+	if (p)
+	    succ(p) = s;
+	else
+	    head = s;
+	if (s)
+	    pred(s) = p;
+    }
+};
+
+/*
+ * Free lists. Each one keeps the free blocks of the heap and walks
+ * them from first() with next() until nullptr. klass() tells BestFit
+ * when the blocks still to come are all larger than the ones seen.
+ */
+
+/* Implicit - No list: walk every block of the heap */
+template <class L>
+struct Implicit {
+    static constexpr std::size_t LINK_BYTES = 0;
+    char *heap = nullptr;
+
+    void reset(char *first) { heap = first; }
+    void insert(char *) {}
+    void remove(char *) {}
+    char *first(std::size_t) { return skip(heap); }
+    char *next(char *bp) { return skip(L::next(bp)); }
+    static int klass(std::size_t) { return 0; }
+
+  private:
+    static char *skip(char *bp)
+    {
+	while (L::size(bp) != 0 && L::alloc(bp))
+	    bp = L::next(bp);
+	return L::size(bp) != 0 ? bp : nullptr;
+    }
+};
+
+/* ExplicitLifo - Doubly linked list, freed blocks go to the front */
+template <class L>
+struct ExplicitLifo {
+    static constexpr std::size_t LINK_BYTES = 2 * sizeof(char *);
+    char *head = nullptr;
+
+    void reset(char *) { head = nullptr; }
+    void insert(char *bp) { Links::push(head, bp); }
+    void remove(char *bp) { Links::unlink(head, bp); }
+    char *first(std::size_t) { return head; }
+    char *next(char *bp) { return Links::succ(bp); }
+    static int klass(std::size_t) { return 0; }
+};
+
+/* AddressOrdered - Doubly linked list sorted by address */
+template <class L>
+struct AddressOrdered {
+    static constexpr std::size_t LINK_BYTES = 2 * sizeof(char *);
+    char *head = nullptr;
+
+    void reset(char *) { head = nullptr; }
+    void insert(char *bp)
+    {
+	char *p = nullptr, *s = head;
+
+	while (s && s < bp) {
+	    p = s;
+	    s = Links::succ(s);
+	}
+	Links::succ(bp) = s;
+	Links::pred(bp) = p;
+	if (p)
+	    Links::succ(p) = bp;
+	else
+	    head = bp;
+	if (s)
+	    Links::pred(s) = bp;
+    }
+    void remove(char *bp) { Links::unlink(head, bp); }
+    char *first(std::size_t) { return head; }
+    char *next(char *bp) { return Links::succ(bp); }
+    static int klass(std::size_t) { return 0; }
+};
+
+/* Segregated<N> - N LIFO lists of power-of-two size classes */
+template <int N>
+struct Segregated {
+    template <class L>
+    struct List {
+	static constexpr std::size_t LINK_BYTES = 2 * sizeof(char *);
+	char *heads[N] = {};
+
+	/* class c holds [16 << c, 32 << c), the last class the rest */
+	static int klass(std::size_t size)
+	{
+	    int c = 8 * (int)sizeof(unsigned long) - 1 -
+		__builtin_clzl((unsigned long)(size >> 4) | 1);
+
+	    return c < N - 1 ? c : N - 1;
+	}
+	void reset(char *) { std::memset(heads, 0, sizeof(heads)); }
+	void insert(char *bp) { Links::push(heads[klass(L::size(bp))], bp); }
+	void remove(char *bp) { Links::unlink(heads[klass(L::size(bp))], bp); }
+	char *first(std::size_t size) { return from(klass(size)); }
+	char *next(char *bp)
+	{
+	    char *s = Links::succ(bp);
+
+	    return s ? s : from(klass(L::size(bp)) + 1);
+	}
+
+      private:
+	char *from(int c)
+	{
+	    for (; c < N; c++)
+		if (heads[c])
+		    return heads[c];
+	    return nullptr;
+	}
+    };
+};
+
+/*
+ * Fit strategies. TRACKS says whether the allocator must tell the
+ * strategy about blocks leaving the list and about merges.
+ */
+
+/* FirstFit - The first block that is large enough */
+struct FirstFit {
+    static constexpr bool TRACKS = false;
+
+    void reset() {}
+    void removing(char *, char *) {}
+    void merged(char *, std::size_t) {}
+
+    template <class L, class List>
+    char *find(List &list, std::size_t asize)
+    {
+	for (char *bp = list.first(asize); bp; bp = list.next(bp))
+	    if (L::size(bp) >= asize)
+		return bp;
+	return nullptr;
+    }
+};
+
+/* NextFit - First fit, resuming where the last search stopped */
+struct NextFit {
+    static constexpr bool TRACKS = true;
+    char *rover = nullptr;
+
+    void reset() { rover = nullptr; }
+    void removing(char *bp, char *succ)
+    {
+	if (rover == bp)
+	    rover = succ;
+    }
+    void merged(char *bp, std::size_t size)
+    {
+	if (rover > bp && rover < bp + size)
+	    rover = bp;
+    }
+
+    template <class L, class List>
+    char *find(List &list, std::size_t asize)
+    {
+	char *bp, *start = rover;
+
+	for (bp = start ? start : list.first(asize); bp; bp = list.next(bp))
+	    if (L::size(bp) >= asize)
+		return rover = bp;
+	for (bp = list.first(asize); bp && bp != start; bp = list.next(bp))
+	    if (L::size(bp) >= asize)
+		return rover = bp;
+	return nullptr;
+    }
+};
+
+/* BestFit - The smallest block that is large enough */
+struct BestFit {
+    static constexpr bool TRACKS = false;
+
+    void reset() {}
+    void removing(char *, char *) {}
+    void merged(char *, std::size_t) {}
+
+    template <class L, class List>
+    char *find(List &list, std::size_t asize)
+    {
+	char *best = nullptr;
+
+	for (char *bp = list.first(asize); bp; bp = list.next(bp)) {
+	    std::size_t size = L::size(bp);
+
+	    if (best && List::klass(size) != List::klass(L::size(best)))
+		break;    /* the rest are in larger classes */
+	    if (size >= asize && (!best || size < L::size(best))) {
+		best = bp;
+		if (size == asize)
+		    break;
+	    }
+	}
+	return best;
+    }
+};
+
+/* Growth policies: how many bytes to ask memlib for */
+
+/* FixedChunk - At least Chunk bytes at a time */
+template <std::size_t Chunk>
+struct FixedChunk {
+    static std::size_t grow(std::size_t need, std::size_t)
+    {
+	return need > Chunk ? need : Chunk;
+    }
+};
+
+/* Geometric - At least Num/Den of the heap, and at least Min bytes */
+template <std::size_t Min, std::size_t Num, std::size_t Den>
+struct Geometric {
+    static std::size_t grow(std::size_t need, std::size_t heap)
+    {
+	std::size_t g = heap * Num / Den;
+
+	if (g < Min)
+	    g = Min;
+	return need > g ? need : g;
+    }
+};
+
+/*
+ * Allocator - The heap: a prologue block, the blocks and an epilogue
+ *     header, always coalesced, so that the next block of a free block
+ *     is allocated (or the epilogue)
+ */
+template <class L, template <class> class FreeList, class Fit, class Growth>
+class Allocator {
+  public:
+    using List = FreeList<L>;
+
+    static constexpr std::size_t MIN_BLOCK =
+	align_up(2 * L::W + List::LINK_BYTES) > 2 * ALIGNMENT ?
+	align_up(2 * L::W + List::LINK_BYTES) : 2 * ALIGNMENT;
+
+    int init()
+    {
+	char *p = static_cast<char *>(mem_sbrk(2 * ALIGNMENT));
+
+	if (p == reinterpret_cast<char *>(-1))
+	    return -1;
+	/* prologue: an allocated block of ALIGNMENT bytes; epilogue */
+	L::hdr(p + ALIGNMENT) = ALIGNMENT | L::ALLOC | L::PREV_ALLOC;
+	L::hdr(p + 2 * ALIGNMENT) = L::ALLOC | L::PREV_ALLOC;
+	list.reset(p + 2 * ALIGNMENT);
+	fit.reset();
+	return 0;
+    }
+
+    void *malloc(std::size_t size)
+    {
+	std::size_t asize;
+	char *bp;
+
+	if (size == 0)
+	    return nullptr;
+	asize = adjust(size);
+	if ((bp = fit.template find<L>(list, asize)) == nullptr &&
+	    (bp = grow(asize)) == nullptr)
+	    return nullptr;
+	remove(bp);
+	carve(bp, L::size(bp), asize);
+	return bp;
+    }
+
+    void free(void *ptr)
+    {
+	if (ptr)
+	    coalesce(static_cast<char *>(ptr));
+    }
+
+    void *realloc(void *ptr, std::size_t size)
+    {
+	char *bp = static_cast<char *>(ptr), *nx;
+	std::size_t asize, csize;
+	void *np;
+
+	if (ptr == nullptr)
+	    return malloc(size);
+	if (size == 0) {
+	    free(ptr);
+	    return nullptr;
+	}
+	asize = adjust(size);
+	csize = L::size(bp);
+	if (asize <= csize) {
+	    carve(bp, csize, asize);
+	    return ptr;
+	}
+
+	/* grow into the next block, extending the heap if it is the end */
+	nx = L::next(bp);
+	if (L::size(nx) == 0 && extend(asize - csize) != nullptr)
+	    nx = L::next(bp);
+	if (!L::alloc(nx) && csize + L::size(nx) >= asize) {
+	    remove(nx);
+	    carve(bp, csize + L::size(nx), asize);
+	    return ptr;
+	}
+
+	if ((np = malloc(size)) == nullptr)
+	    return nullptr;
+	std::memcpy(np, ptr, csize - L::OVERHEAD < size ? csize - L::OVERHEAD : size);
+	free(ptr);
+	return np;
+    }
+
+  private:
+    List list;
+    Fit fit;
+
+    static std::size_t adjust(std::size_t size)
+    {
+	std::size_t asize = align_up(size + L::OVERHEAD);
+
+	return asize > MIN_BLOCK ? asize : MIN_BLOCK;
+    }
+
+    void remove(char *bp)
+    {
+	if constexpr (Fit::TRACKS)
+	    fit.removing(bp, list.next(bp));
+	list.remove(bp);
+    }
+
+    /*
+     * carve - Make bp an allocated block of asize out of its csize
+     *     bytes, freeing the rest if it can hold a block
+     */
+    void carve(char *bp, std::size_t csize, std::size_t asize)
+    {
+	if (csize - asize >= MIN_BLOCK) {
+	    char *rest;
+
+	    L::template set<true>(bp, asize);
+	    rest = L::next(bp);
+	    L::hdr(rest) = L::PREV_ALLOC;
+	    L::template set<true>(rest, csize - asize);
+	    coalesce(rest);
+	} else {
+	    L::template set<true>(bp, csize);
+	}
+    }
+
+    /*
+     * coalesce - Merge the block bp (allocated or not yet listed) with
+     *     its free neighbours and list the result
+     */
+    char *coalesce(char *bp)
+    {
+	std::size_t size = L::size(bp);
+	char *nx = L::next(bp);
+
+	if (!L::alloc(nx)) {
+	    remove(nx);
+	    size += L::size(nx);
+	}
+	if (!L::prev_alloc(bp)) {
+	    bp = L::prev(bp);
+	    remove(bp);
+	    size += L::size(bp);
+	}
+	L::template set<false>(bp, size);
+	if constexpr (Fit::TRACKS)
+	    fit.merged(bp, size);
+	list.insert(bp);
+	return bp;
+    }
+
+    /*
+     * extend - Add at least bytes to the heap as a free block, merged
+     *     with the last block if that one is free
+     */
+    char *extend(std::size_t bytes)
+    {
+	char *bp;
+
+	bytes = align_up(bytes);
+	if ((bp = static_cast<char *>(mem_sbrk((int)bytes))) ==
+	    reinterpret_cast<char *>(-1))
+	    return nullptr;
+	/* the old epilogue header becomes the new block's header */
+	L::hdr(bp) = typename L::word_t(bytes) | (L::hdr(bp) & L::PREV_ALLOC) |
+	    L::ALLOC;
+	L::hdr(bp + bytes) = L::ALLOC;
+	return coalesce(bp);
+    }
+
+    /*
+     * grow - Extend the heap for a block of asize, asking only for
+     *     what the free block at its end lacks
+     */
+    char *grow(std::size_t asize)
+    {
+	char *end = static_cast<char *>(mem_heap_hi()) + 1;
+	std::size_t need = asize;
+
+	if (!L::prev_alloc(end))
+	    need -= L::size(L::prev(end));
+	return extend(Growth::grow(need, mem_heapsize()));
+    }
+};
+
+} /* namespace mmpolicy */
+
+#endif /* __MMPOLICY_HPP_ */
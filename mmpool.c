@@ -0,0 +1,242 @@
+/*
+ * mmpool.c - Pools of fixed-size objects (see mmpool.h)
+ *
+ * A slab is one mm_malloc'd block: a header linking it to the other
+ * slabs of its pool, then slot-sized slots. Only the newest slab is
+ * cut up lazily, [ptr, end) being its slots never handed out; every
+ * slot given back goes on the pool's free list, linked through its
+ * first word. Allocation takes the head of the free list, else the
+ * next uncut slot, else a new slab.
+ *
+ * With MM_POOL_MAGAZINES, each thread has an array of magazines
+ * indexed by pool id. A thread allocates from and frees to its own
+ * magazine, and moves half a magazine of slots from or to the pool,
+ * under the lock, when it runs empty or full. Pools past the first
+ * MAX_POOLS have no magazines and take the lock on every call.
+ */
+#include "mm.h"
+#include "mmpool.h"
+
+#ifdef MM_POOL_MAGAZINES
+#include <pthread.h>
+#endif
+
+#define POOL_ALIGN    8               /* least alignment of the slots */
+#define SLAB_SIZE     (16*1024)       /* bytes asked for a slab */
+#define MIN_SLOTS     8               /* least slots in a slab */
+
+#define ROUND(n, a)   (((n) + (a) - 1) & ~(size_t)((a) - 1))
+#define MAX(x, y)     ((x) > (y) ? (x) : (y))
+
+/* A slab: this header, then its slots from SLOTS(s) */
+typedef struct slab {
+    struct slab *next;      /* the previous slab of the pool */
+} slab_t;
+
+#define SLOTS(p, s)   ((char *)(s) + ROUND(sizeof(slab_t), (p)->align))
+
+struct mm_pool {
+    size_t slot;            /* bytes per slot */
+    size_t align;           /* alignment of the slots */
+    size_t per_slab;        /* slots in a slab */
+    void *free;             /* slots given back */
+    char *ptr;              /* next uncut slot of the newest slab */
+    char *end;              /* end of the newest slab's slots */
+    slab_t *slabs;          /* newest slab first */
+#ifdef MM_POOL_MAGAZINES
+    int id;                 /* index of the pool's magazines */
+#endif
+};
+
+#ifdef MM_POOL_MAGAZINES
+#define MAG_SIZE      32              /* slots held by a magazine */
+#define MAX_POOLS     64              /* pools that get magazines */
+
+typedef struct {
+    int n;                  /* slots in slots[0..n) */
+    void *slots[MAG_SIZE];
+} magazine_t;
+
+static __thread magazine_t mags[MAX_POOLS];
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int next_id;         /* id of the next pool created */
+
+#define LOCK()        pthread_mutex_lock(&lock)
+#define UNLOCK()      pthread_mutex_unlock(&lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+/*
+ * mm_pool_create - The pool, with no slab yet
+ */
+mm_pool_t *mm_pool_create(size_t obj_size, size_t align)
+{
+    mm_pool_t *pool;
+
+    if (align == 0)
+	align = POOL_ALIGN;
+    if ((align & (align - 1)) != 0)
+	return NULL;
+    align = MAX(align, POOL_ALIGN);
+    LOCK();
+    pool = mm_malloc(sizeof(mm_pool_t));
+#ifdef MM_POOL_MAGAZINES
+    if (pool != NULL)
+	pool->id = next_id++;
+#endif
+    UNLOCK();
+    if (pool == NULL)
+	return NULL;
+    pool->slot = ROUND(MAX(obj_size, sizeof(void *)), align);
+    pool->align = align;
+    pool->per_slab = MAX(MIN_SLOTS,
+			 (SLAB_SIZE - ROUND(sizeof(slab_t), align)) / pool->slot);
+    pool->free = NULL;
+    pool->ptr = pool->end = NULL;
+    pool->slabs = NULL;
+    return pool;
+}
+
+/*
+ * new_slab - Make a new slab the one being cut up; 0 if there is no
+ *     memory. Slots aligned beyond what mm_malloc gives need the slab
+ *     aligned too.
+ */
+static int new_slab(mm_pool_t *pool)
+{
+    size_t bytes = ROUND(sizeof(slab_t), pool->align) +
+	pool->per_slab * pool->slot;
+    slab_t *s;
+
+    if (pool->align > POOL_ALIGN)
+	s = mm_memalign(pool->align, bytes);
+    else
+	s = mm_malloc(bytes);
+    if (s == NULL)
+	return 0;
+    s->next = pool->slabs;
+    pool->slabs = s;
+    pool->ptr = SLOTS(pool, s);
+    pool->end = pool->ptr + pool->per_slab * pool->slot;
+    return 1;
+}
+
+/*
+ * get_slot - A free slot, or a new one, of pool
+ */
+static void *get_slot(mm_pool_t *pool)
+{
+    void *obj;
+
+    if ((obj = pool->free) != NULL) {
+	pool->free = *(void **)obj;
+	return obj;
+    }
+    if (pool->ptr == pool->end && !new_slab(pool))
+	return NULL;
+    obj = pool->ptr;
+    pool->ptr += pool->slot;
+    return obj;
+}
+
+/*
+ * put_slot - Push obj on the free list of pool
+ */
+static void put_slot(mm_pool_t *pool, void *obj)
+{
+    *(void **)obj = pool->free;
+    pool->free = obj;
+}
+
+#ifdef MM_POOL_MAGAZINES
+/*
+ * mm_pool_alloc - From the thread's magazine, refilled from the pool
+ */
+void *mm_pool_alloc(mm_pool_t *pool)
+{
+    magazine_t *m;
+    void *obj;
+
+    if (pool->id >= MAX_POOLS) {
+	LOCK();
+	obj = get_slot(pool);
+	UNLOCK();
+	return obj;
+    }
+    m = &mags[pool->id];
+    if (m->n == 0) {
+	LOCK();
+	while (m->n < MAG_SIZE / 2 && (obj = get_slot(pool)) != NULL)
+	    m->slots[m->n++] = obj;
+	UNLOCK();
+	if (m->n == 0)
+	    return NULL;
+    }
+    return m->slots[--m->n];
+}
+
+/*
+ * mm_pool_free - To the thread's magazine, half of it drained to the
+ *     pool when it is full
+ */
+void mm_pool_free(mm_pool_t *pool, void *obj)
+{
+    magazine_t *m;
+
+    if (pool->id >= MAX_POOLS) {
+	LOCK();
+	put_slot(pool, obj);
+	UNLOCK();
+	return;
+    }
+    m = &mags[pool->id];
+    if (m->n == MAG_SIZE) {
+	LOCK();
+	while (m->n > MAG_SIZE / 2)
+	    put_slot(pool, m->slots[--m->n]);
+	UNLOCK();
+    }
+    m->slots[m->n++] = obj;
+}
+#else
+/*
+ * mm_pool_alloc - Pop a free slot, or cut a new one
+ */
+void *mm_pool_alloc(mm_pool_t *pool)
+{
+    return get_slot(pool);
+}
+
+/*
+ * mm_pool_free - Push obj on the free list
+ */
+void mm_pool_free(mm_pool_t *pool, void *obj)
+{
+    put_slot(pool, obj);
+}
+#endif
+
+/*
+ * mm_pool_destroy - Free the slabs, then the pool. With magazines, the
+ *     pool must no longer be used by other threads; the slots their
+ *     magazines still hold are dropped along with it (ids are not
+ *     reused, so they are never read again).
+ */
+void mm_pool_destroy(mm_pool_t *pool)
+{
+    slab_t *s, *next;
+
+#ifdef MM_POOL_MAGAZINES
+    if (pool->id < MAX_POOLS)
+	mags[pool->id].n = 0;
+#endif
+    LOCK();
+    for (s = pool->slabs; s != NULL; s = next) {
+	next = s->next;
+	mm_free(s);
+    }
+    mm_free(pool);
+    UNLOCK();
+}
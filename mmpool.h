@@ -0,0 +1,40 @@
+/*
+ * mmpool.h - Pools of fixed-size objects in slabs from mm_malloc
+ *
+ * A pool hands out objects of the size it was created for. They are
+ * cut from slabs allocated on the heap, so the objects themselves
+ * carry no header or footer, and allocating one does not search the
+ * free list: a freed object goes on the pool's own intrusive list of
+ * free slots and is the next one handed out. The pool grows one slab
+ * at a time, cutting slots off the newest slab as they are needed.
+ *
+ * Built with -DMM_POOL_MAGAZINES, pools may be used by several
+ * threads: each thread keeps a small magazine of free slots per pool,
+ * and only takes the pools' lock to refill or drain it. The slabs
+ * still come from mm_malloc under that lock, so any other use of the
+ * heap must be serialized with it.
+ */
+#ifndef __MMPOOL_H_
+#define __MMPOOL_H_
+
+#include <stddef.h>
+
+typedef struct mm_pool mm_pool_t;
+
+/*
+ * mm_pool_create - New pool of objects of obj_size bytes aligned to
+ *     align (a power of two; 0 for 8). The heap must be initialized
+ *     (mm_init). Returns NULL if there is no memory.
+ */
+mm_pool_t *mm_pool_create(size_t obj_size, size_t align);
+
+/* mm_pool_alloc - An object, or NULL if there is no memory */
+void *mm_pool_alloc(mm_pool_t *pool);
+
+/* mm_pool_free - Give obj, allocated from pool, back to it */
+void mm_pool_free(mm_pool_t *pool, void *obj);
+
+/* mm_pool_destroy - Return the slabs of pool to the heap */
+void mm_pool_destroy(mm_pool_t *pool);
+
+#endif /* __MMPOOL_H_ */
@@ -0,0 +1,283 @@
+/*
+ * mmprof.c - Sampling heap profiler with allocation-site attribution
+ *
+ * The profiler keeps two tables: the call-site buckets, keyed by the
+ * backtrace of the sampled mm_malloc, which accumulate allocated and
+ * live counts, and the sampled blocks, keyed by block pointer, which
+ * remember the bucket to charge when the block is freed. Both tables
+ * live in memory mapped directly from the OS, never in the libc heap,
+ * so the profiler also works when the allocator *is* the libc heap.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <execinfo.h>
+#include <sys/mman.h>
+
+#include "mmprof.h"
+
+#define MAX_DEPTH    32         /* deepest backtrace recorded */
+#define BUCKET_HASH  1021       /* hash chains of call-site buckets */
+#define SAMPLE_HASH  4093       /* hash chains of sampled blocks */
+#define POOL_CHUNK   (1<<16)    /* bytes mapped at a time for the tables */
+
+/* A call site: one distinct backtrace and what it allocated */
+typedef struct bucket {
+    struct bucket *next;
+    unsigned long hash;
+    int depth;
+    void *stack[MAX_DEPTH];
+    long alloc_objs, alloc_bytes;   /* cumulative samples */
+    long live_objs, live_bytes;     /* samples not freed yet */
+} bucket_t;
+
+/* A sampled block that has not been freed yet */
+typedef struct sample {
+    struct sample *next;
+    void *bp;
+    size_t size;
+    bucket_t *bucket;
+} sample_t;
+
+/* A chunk of mapped memory the tables are carved from */
+typedef struct chunk {
+    struct chunk *next;
+} chunk_t;
+
+long prof_countdown = LONG_MAX;        /* bytes until the next sample */
+static long mean_interval = 0;         /* 0 when not sampling */
+static unsigned long long rng = 88172645463325252ULL;
+
+static bucket_t *buckets[BUCKET_HASH];
+static sample_t *samples[SAMPLE_HASH];
+static sample_t *free_samples;         /* recycled sample records */
+static long live_samples;              /* sampled blocks not yet freed */
+static chunk_t *chunks;                /* all mapped chunks */
+static char *pool_next, *pool_end;     /* unused part of the last chunk */
+
+/*
+ * pool_alloc - Carve size bytes out of the mapped chunks
+ */
+static void *pool_alloc(size_t size)
+{
+    void *p;
+
+    size = (size + 7) & ~(size_t)7;
+    if (pool_next == NULL || pool_next + size > pool_end) {
+	chunk_t *c = mmap(NULL, POOL_CHUNK, PROT_READ | PROT_WRITE,
+			  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (c == MAP_FAILED)
+	    return NULL;
+	c->next = chunks;
+	chunks = c;
+	pool_next = (char *)c + sizeof(double);
+	pool_end = (char *)c + POOL_CHUNK;
+    }
+    p = pool_next;
+    pool_next += size;
+    return p;
+}
+
+/*
+ * next_interval - Draw the number of bytes until the next sample from
+ *     an exponential distribution with the configured mean
+ */
+static long next_interval(void)
+{
+    double u, n;
+
+    /* xorshift64* */
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    u = ((rng * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+    if (u <= 0)
+	u = 1e-12;
+    n = -log(u) * mean_interval;
+    if (n < 1)
+	return 1;
+    if (n > LONG_MAX / 2)
+	return LONG_MAX / 2;
+    return (long)n;
+}
+
+/*
+ * find_bucket - Return the bucket for a backtrace, creating it if needed
+ */
+static bucket_t *find_bucket(void **stack, int depth)
+{
+    unsigned long h = 0;
+    bucket_t *b;
+    int i;
+
+    for (i = 0; i < depth; i++)
+	h = h * 31 + (unsigned long)stack[i];
+    for (b = buckets[h % BUCKET_HASH]; b != NULL; b = b->next) {
+	if (b->hash == h && b->depth == depth &&
+	    memcmp(b->stack, stack, depth * sizeof(void *)) == 0)
+	    return b;
+    }
+    if ((b = pool_alloc(sizeof(bucket_t))) == NULL)
+	return NULL;
+    memset(b, 0, sizeof(*b));
+    b->hash = h;
+    b->depth = depth;
+    memcpy(b->stack, stack, depth * sizeof(void *));
+    b->next = buckets[h % BUCKET_HASH];
+    buckets[h % BUCKET_HASH] = b;
+    return b;
+}
+
+/*
+ * mm_prof_enable - Set the mean sampling interval (0 = off)
+ */
+void mm_prof_enable(size_t mean_bytes)
+{
+    void *warm[1];
+
+    /* The first backtrace() may load libgcc and call malloc; do it now
+       rather than from inside the allocator. */
+    backtrace(warm, 1);
+    mean_interval = (long)mean_bytes;
+    prof_countdown = mean_interval ? next_interval() : LONG_MAX;
+}
+
+/*
+ * prof_alloc - Slow path of a sampled mm_malloc: charge the block to
+ *     the caller's backtrace and start tracking it
+ */
+int prof_alloc(void *bp, size_t size)
+{
+    void *stack[MAX_DEPTH + 1];
+    bucket_t *b;
+    sample_t *s;
+    int depth;
+
+    if (mean_interval == 0) {
+	prof_countdown = LONG_MAX;
+	return 0;
+    }
+    prof_countdown = next_interval();
+
+    /* drop our own frame, keep mm_malloc and its callers (mm.c inlines
+       the helpers that call us, so our caller is the entry point) */
+    depth = backtrace(stack, MAX_DEPTH + 1) - 1;
+    if ((b = find_bucket(stack + 1, depth)) == NULL)
+	return 0;
+    if ((s = free_samples) != NULL)
+	free_samples = s->next;
+    else if ((s = pool_alloc(sizeof(sample_t))) == NULL)
+	return 0;
+
+    s->bp = bp;
+    s->size = size;
+    s->bucket = b;
+    s->next = samples[((unsigned long)bp >> 3) % SAMPLE_HASH];
+    samples[((unsigned long)bp >> 3) % SAMPLE_HASH] = s;
+    live_samples++;
+
+    b->alloc_objs++;
+    b->alloc_bytes += size;
+    b->live_objs++;
+    b->live_bytes += size;
+    return 1;
+}
+
+/*
+ * prof_free - A sampled block is freed: stop tracking it
+ */
+void prof_free(void *bp)
+{
+    sample_t **sp, *s;
+
+    for (sp = &samples[((unsigned long)bp >> 3) % SAMPLE_HASH];
+	 (s = *sp) != NULL; sp = &s->next) {
+	if (s->bp == bp) {
+	    *sp = s->next;
+	    s->bucket->live_objs--;
+	    s->bucket->live_bytes -= s->size;
+	    s->next = free_samples;
+	    free_samples = s;
+	    live_samples--;
+	    return;
+	}
+    }
+}
+
+/*
+ * prof_heap_reset - mm_init threw the whole heap away, so no sampled
+ *     block is live any more
+ */
+void prof_heap_reset(void)
+{
+    int i;
+
+    for (i = 0; i < SAMPLE_HASH && live_samples > 0; i++) {
+	while (samples[i] != NULL)
+	    prof_free(samples[i]->bp);
+    }
+}
+
+/*
+ * mm_prof_clear - Forget every sample and release the tables
+ */
+void mm_prof_clear(void)
+{
+    chunk_t *c;
+
+    while ((c = chunks) != NULL) {
+	chunks = c->next;
+	munmap(c, POOL_CHUNK);
+    }
+    memset(buckets, 0, sizeof(buckets));
+    memset(samples, 0, sizeof(samples));
+    free_samples = NULL;
+    live_samples = 0;
+    pool_next = pool_end = NULL;
+}
+
+/*
+ * mm_prof_dump - Write the profile in the pprof heap_v2 text format
+ */
+int mm_prof_dump(FILE *fp, int live_only)
+{
+    long live_objs = 0, live_bytes = 0, alloc_objs = 0, alloc_bytes = 0;
+    bucket_t *b;
+    FILE *maps;
+    char line[512];
+    int i, j;
+
+    for (i = 0; i < BUCKET_HASH; i++) {
+	for (b = buckets[i]; b != NULL; b = b->next) {
+	    live_objs += b->live_objs;
+	    live_bytes += b->live_bytes;
+	    alloc_objs += b->alloc_objs;
+	    alloc_bytes += b->alloc_bytes;
+	}
+    }
+    fprintf(fp, "heap profile: %6ld: %8ld [%6ld: %8ld] @ heap_v2/%ld\n",
+	    live_objs, live_bytes, alloc_objs, alloc_bytes, mean_interval);
+
+    for (i = 0; i < BUCKET_HASH; i++) {
+	for (b = buckets[i]; b != NULL; b = b->next) {
+	    if (live_only && b->live_objs == 0)
+		continue;
+	    fprintf(fp, "%6ld: %8ld [%6ld: %8ld] @",
+		    b->live_objs, b->live_bytes, b->alloc_objs, b->alloc_bytes);
+	    for (j = 0; j < b->depth; j++)
+		fprintf(fp, " %p", b->stack[j]);
+	    fprintf(fp, "\n");
+	}
+    }
+
+    /* pprof needs the mappings to symbolize the addresses */
+    fprintf(fp, "\nMAPPED_LIBRARIES:\n");
+    if ((maps = fopen("/proc/self/maps", "r")) != NULL) {
+	while (fgets(line, sizeof(line), maps) != NULL)
+	    fputs(line, fp);
+	fclose(maps);
+    }
+    return ferror(fp) ? -1 : 0;
+}
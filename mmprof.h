@@ -0,0 +1,44 @@
+/*
+ * mmprof.h - sampling heap profiler for the mm.c allocator
+ *
+ * When enabled, mm_malloc samples allocations at a mean interval of
+ * N allocated bytes (the gap between two samples is geometrically
+ * distributed, so every byte has the same chance to be picked) and
+ * records a backtrace for each sampled block. Sampled blocks are
+ * tracked until they are freed. The profile can be dumped in the
+ * pprof (gperftools heap_v2) text format, which carries both the
+ * live heap and the cumulative allocations:
+ *
+ *     unix> pprof --inuse_space mdriver heap.prof
+ *     unix> pprof --alloc_space mdriver heap.prof
+ */
+#include <stdio.h>
+
+/*
+ * mm_prof_enable - Start sampling every mean_bytes allocated bytes on
+ *     average. 0 stops sampling; blocks already sampled stay tracked.
+ */
+void mm_prof_enable(size_t mean_bytes);
+
+/*
+ * mm_prof_dump - Write the profile to fp. When live_only is set, call
+ *     sites that hold no sampled block any more are left out.
+ *     Returns 0 on success, -1 on an I/O error.
+ */
+int mm_prof_dump(FILE *fp, int live_only);
+
+/* mm_prof_clear - Forget all samples, live and cumulative */
+void mm_prof_clear(void);
+
+/*
+ * Hooks used by mm.c. PROF_SAMPLE is the only cost an unsampled
+ * allocation pays: it counts down the bytes left until the next
+ * sample and is true once they run out.
+ */
+extern long prof_countdown;
+
+#define PROF_SAMPLE(size) ((prof_countdown -= (long)(size)) < 0)
+
+int prof_alloc(void *bp, size_t size); /* nonzero if bp is now sampled */
+void prof_free(void *bp);              /* bp was sampled and is freed */
+void prof_heap_reset(void);            /* the heap was reinitialized */
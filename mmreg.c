@@ -0,0 +1,117 @@
+/*
+ * mmreg.c - The allocator variants known to the tools
+ *
+ *   mm        mm.c: explicit free list (built with the explicit_ prefix)
+ *   mm-hint   mm.c with every malloc lifetime hinted by MM_HINT_AUTO
+ *   mm-ao     mm.c built with ADDRESS_ORDERED: address-ordered free
+ *             list, first fit (ao_ prefix)
+ *   firstfit  mm-firstfit.c: implicit list, first fit (firstfit_ prefix)
+ *   libc      the C library's malloc, as a baseline; its heap is not
+ *             memlib's, so its utilization cannot be measured
+ *   p-*       configurations of the policy allocator (mm-policy.cpp)
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "mmreg.h"
+
+/* mm.c, compiled with the explicit_ prefix */
+extern int explicit_mm_init(void);
+extern void *explicit_mm_malloc(size_t size);
+extern void *explicit_mm_malloc_hint(size_t size, int hint);
+extern void explicit_mm_free(void *ptr);
+extern void *explicit_mm_realloc(void *ptr, size_t size);
+extern void explicit_mm_stats(mm_stats_t *stats);
+
+/* mm.c built with ADDRESS_ORDERED, compiled with the ao_ prefix */
+extern int ao_mm_init(void);
+extern void *ao_mm_malloc(size_t size);
+extern void ao_mm_free(void *ptr);
+extern void *ao_mm_realloc(void *ptr, size_t size);
+extern void ao_mm_stats(mm_stats_t *stats);
+
+/* mm-firstfit.c, compiled with the firstfit_ prefix */
+extern int firstfit_mm_init(void);
+extern void *firstfit_mm_malloc(size_t size);
+extern void firstfit_mm_free(void *ptr);
+extern void *firstfit_mm_realloc(void *ptr, size_t size);
+
+/* mm-policy.cpp */
+extern mm_alloc_t policy_implicit_first_alloc, policy_implicit_next_alloc;
+extern mm_alloc_t policy_lifo_first_alloc, policy_addr_first_alloc;
+extern mm_alloc_t policy_addr_best_alloc, policy_seg_first_alloc;
+extern mm_alloc_t policy_seg_best_alloc;
+
+/*
+ * libc_init - Nothing to set up: the C library's heap persists
+ */
+static int libc_init(void)
+{
+    return 0;
+}
+
+/*
+ * hint_malloc - mm.c's malloc with the lifetime predicted per size
+ */
+static void *hint_malloc(size_t size)
+{
+    return explicit_mm_malloc_hint(size, MM_HINT_AUTO);
+}
+
+static mm_alloc_t explicit_alloc = {
+    "mm", "explicit free list (mm.c)",
+    explicit_mm_init, explicit_mm_malloc, explicit_mm_free,
+    explicit_mm_realloc, explicit_mm_stats, 1
+};
+
+static mm_alloc_t hint_alloc = {
+    "mm-hint", "mm.c, lifetimes predicted (mm_malloc_hint, MM_HINT_AUTO)",
+    explicit_mm_init, hint_malloc, explicit_mm_free,
+    explicit_mm_realloc, explicit_mm_stats, 1
+};
+
+static mm_alloc_t ao_alloc = {
+    "mm-ao", "mm.c, address-ordered free list (ADDRESS_ORDERED)",
+    ao_mm_init, ao_mm_malloc, ao_mm_free,
+    ao_mm_realloc, ao_mm_stats, 1
+};
+
+static mm_alloc_t firstfit_alloc = {
+    "firstfit", "implicit list, first fit (mm-firstfit.c)",
+    firstfit_mm_init, firstfit_mm_malloc, firstfit_mm_free,
+    firstfit_mm_realloc, NULL, 1
+};
+
+static mm_alloc_t libc_alloc = {
+    "libc", "C library malloc",
+    libc_init, malloc, free, realloc, NULL, 0
+};
+
+mm_alloc_t *mm_allocators[] = {
+    &explicit_alloc,
+    &hint_alloc,
+    &ao_alloc,
+    &firstfit_alloc,
+    &libc_alloc,
+    &policy_implicit_first_alloc,
+    &policy_implicit_next_alloc,
+    &policy_lifo_first_alloc,
+    &policy_addr_first_alloc,
+    &policy_addr_best_alloc,
+    &policy_seg_first_alloc,
+    &policy_seg_best_alloc,
+    NULL
+};
+
+/*
+ * mm_find_allocator - Look a variant up by name
+ */
+mm_alloc_t *mm_find_allocator(const char *name)
+{
+    int i;
+
+    for (i = 0; mm_allocators[i] != NULL; i++)
+	if (strcmp(mm_allocators[i]->name, name) == 0)
+	    return mm_allocators[i];
+    return NULL;
+}
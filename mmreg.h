@@ -0,0 +1,32 @@
+/*
+ * mmreg.h - Registry of the allocator variants the tools can run
+ *
+ * Every variant defines the same mm_init/mm_malloc/mm_free/mm_realloc
+ * and team symbols, so the Makefile compiles each one with those names
+ * prefixed (see MM_RENAME) and the registry reaches them through a
+ * table of entry points. To add a variant, compile it with its own
+ * prefix, declare its entry points in mmreg.c and list it there.
+ */
+#ifndef __MMREG_H_
+#define __MMREG_H_
+
+#include "mm.h"
+
+typedef struct {
+    const char *name;              /* short name, e.g. for mbench -a */
+    const char *description;
+    int (*init)(void);
+    void *(*malloc)(size_t size);
+    void (*free)(void *ptr);
+    void *(*realloc)(void *ptr, size_t size);
+    void (*stats)(mm_stats_t *stats);  /* NULL if the variant has none */
+    int memlib;                    /* nonzero if its heap is memlib's */
+} mm_alloc_t;
+
+/* The variants, terminated by a NULL entry; the first is mm.c */
+extern mm_alloc_t *mm_allocators[];
+
+/* mm_find_allocator - The variant called name, or NULL */
+mm_alloc_t *mm_find_allocator(const char *name);
+
+#endif /* __MMREG_H_ */
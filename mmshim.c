@@ -0,0 +1,218 @@
+/*
+ * mmshim.c - The allocator as the C library's malloc (LD_PRELOAD)
+ *
+ * Built into libmm.so (make libmm.so), this file exports malloc, free,
+ * free_sized, calloc, realloc, posix_memalign, aligned_alloc, memalign,
+ * valloc and malloc_usable_size on top of mm.c, so that real programs
+ * can be run on the allocator:
+ *
+ *   LD_PRELOAD=./libmm.so program args
+ *
+ * memlib is built with MEM_MMAP, so the heap is address space reserved
+ * with mmap (MAX_HEAP bytes) whose pages are only backed once the heap
+ * reaches them: the RSS of the program is the real footprint of mm.c.
+ * The heap is set up by the first call, whichever it is. mm.c is not
+ * thread safe, so every call holds one global lock; the lock is taken
+ * across fork, so that the child inherits a consistent heap.
+ *
+ * mm.c's tags are 32 bits wide: the shim is built with -m32 and only
+ * runs 32-bit programs.
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int initialized;
+
+/*
+ * heap_lock - Take the lock, setting the heap up on first use
+ */
+static void heap_lock(void)
+{
+    pthread_mutex_lock(&lock);
+    if (!initialized) {
+	mem_init();
+	if (mm_init() < 0)
+	    abort();
+	initialized = 1;
+    }
+}
+
+static void heap_unlock(void)
+{
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * owned - Whether ptr lies in the heap. Memory handed out before the
+ *     shim was loaded (by the dynamic loader) is not ours to free.
+ */
+static int owned(void *ptr)
+{
+    return initialized && (char *)ptr >= (char *)mem_heap_lo() &&
+	(char *)ptr <= (char *)mem_heap_hi();
+}
+
+/*
+ * The fork handlers: no other thread may be inside mm.c while the
+ * heap is copied
+ */
+static void fork_prepare(void)
+{
+    pthread_mutex_lock(&lock);
+}
+
+static void fork_parent(void)
+{
+    pthread_mutex_unlock(&lock);
+}
+
+static void fork_child(void)
+{
+    pthread_mutex_init(&lock, NULL);
+}
+
+/*
+ * shim_init - Register the fork handlers. Not done in heap_lock:
+ *     pthread_atfork may itself call malloc.
+ */
+__attribute__((constructor))
+static void shim_init(void)
+{
+    pthread_atfork(fork_prepare, fork_parent, fork_child);
+}
+
+void *malloc(size_t size)
+{
+    void *p;
+
+    heap_lock();
+    p = mm_malloc(size ? size : 1);   /* malloc(0) is a unique pointer */
+    heap_unlock();
+    if (p == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+void free(void *ptr)
+{
+    if (ptr == NULL)
+	return;
+    heap_lock();
+    if (owned(ptr))
+	mm_free(ptr);
+    heap_unlock();
+}
+
+/*
+ * free_sized - C23's free with the size the block was allocated with.
+ *     A different size is undefined in C23; mm_free_sized only asserts
+ *     on it (see mm.h).
+ */
+void free_sized(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+	return;
+    heap_lock();
+    if (owned(ptr))
+	mm_free_sized(ptr, size ? size : 1);
+    heap_unlock();
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (nmemb == 0 || size == 0)
+	nmemb = size = 1;
+    heap_lock();
+    p = mm_calloc(nmemb, size);
+    heap_unlock();
+    if (p == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+/*
+ * realloc - On failure ptr is left as it was. A block the heap does
+ *     not own cannot be resized (its size is unknown): like free, the
+ *     shim leaves it alone, and fails.
+ */
+void *realloc(void *ptr, size_t size)
+{
+    void *p = NULL;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if (size == 0) {
+	free(ptr);
+	return NULL;
+    }
+    heap_lock();
+    if (owned(ptr))
+	p = mm_realloc(ptr, size);
+    heap_unlock();
+    if (p == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *p;
+
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+	return EINVAL;
+    heap_lock();
+    p = mm_memalign(alignment, size ? size : 1);
+    heap_unlock();
+    if (p == NULL)
+	return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *p;
+    int err;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+	errno = EINVAL;
+	return NULL;
+    }
+    if (alignment < sizeof(void *))
+	alignment = sizeof(void *);
+    if ((err = posix_memalign(&p, alignment, size)) != 0) {
+	errno = err;
+	return NULL;
+    }
+    return p;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+void *valloc(size_t size)
+{
+    return memalign(mem_pagesize(), size);
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+    size_t size = 0;
+
+    if (ptr == NULL)
+	return 0;
+    heap_lock();
+    if (owned(ptr))
+	size = mm_usable_size(ptr);
+    heap_unlock();
+    return size;
+}
@@ -0,0 +1,151 @@
+/*
+ * mmtyped.hpp - Allocation of compile-time sizes in size classes (C++17)
+ *
+ *   void *p = mm::alloc<N>();           N bytes (alignment 8)
+ *   mm::free<N>(p);
+ *   T *t = mm::make<T>(args...);        alloc<sizeof(T), alignof(T)>
+ *   mm::destroy(t);                     and placement new, and back
+ *
+ * mm_malloc works the block size out of the request and searches the
+ * free list on every call. Here the size is a template argument, so
+ * the size class is found in a constexpr table when the call is
+ * compiled. Sizes up to MAX_SMALL have a bin per class: a free list
+ * of slots that alloc pops and free pushes, inlined at the call site
+ * (a load, a test and a store each way). An empty bin is refilled
+ * from the class's mm_pool_t, created on first use. Larger sizes, and
+ * alignments above 8, go straight to mm_malloc or mm_memalign and
+ * back with mm_free_sized.
+ *
+ * Slots freed to a bin stay there for the next alloc of their class;
+ * they are not returned to the heap. A pointer must be freed with the
+ * N it was allocated with (for destroy, its dynamic type must be T).
+ * Like mm.c, the bins are for one thread at a time. alloc and make
+ * return nullptr when out of memory.
+ */
+#ifndef __MMTYPED_HPP_
+#define __MMTYPED_HPP_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+extern "C" {
+#include "mm.h"
+#include "mmpool.h"
+}
+
+namespace mm {
+
+/*
+ * The size classes: 8 byte steps to 64, then four classes per
+ * doubling up to MAX_SMALL
+ */
+constexpr std::size_t CLASS_SIZE[] = {
+    8, 16, 24, 32, 40, 48, 56, 64,
+    80, 96, 112, 128, 160, 192, 224, 256,
+};
+constexpr int NUM_CLASSES = sizeof(CLASS_SIZE) / sizeof(CLASS_SIZE[0]);
+constexpr std::size_t MAX_SMALL = CLASS_SIZE[NUM_CLASSES - 1];
+constexpr std::size_t CLASS_ALIGN = 8;
+
+/* class_of - The smallest class holding n bytes, NUM_CLASSES if none */
+constexpr int class_of(std::size_t n)
+{
+    int c = 0;
+
+    while (c < NUM_CLASSES && CLASS_SIZE[c] < n)
+	c++;
+    return c;
+}
+
+static_assert(class_of(1) == 0 && class_of(8) == 0 && class_of(9) == 1);
+static_assert(class_of(MAX_SMALL) == NUM_CLASSES - 1);
+static_assert(class_of(MAX_SMALL + 1) == NUM_CLASSES);
+
+/* A bin: the free slots of a class, and the pool they are cut from */
+struct bin {
+    void *head;
+    mm_pool_t *pool;
+};
+
+inline bin bins[NUM_CLASSES];
+
+/* refill - A slot from the class's pool, created on first use */
+inline void *refill(int c)
+{
+    bin &b = bins[c];
+
+    if (b.pool == nullptr &&
+	(b.pool = mm_pool_create(CLASS_SIZE[c], CLASS_ALIGN)) == nullptr)
+	return nullptr;
+    return mm_pool_alloc(b.pool);
+}
+
+template <std::size_t N, std::size_t Align = CLASS_ALIGN>
+inline void *alloc()
+{
+    static_assert(N > 0, "zero byte allocation");
+    static_assert((Align & (Align - 1)) == 0, "alignment not a power of two");
+    constexpr int c = class_of(N);
+
+    if constexpr (Align > CLASS_ALIGN) {
+	return mm_memalign(Align, N);
+    } else if constexpr (c == NUM_CLASSES) {
+	return mm_malloc(N);
+    } else {
+	bin &b = bins[c];
+	void *p = b.head;
+
+	if (p == nullptr)
+	    return refill(c);
+	b.head = *static_cast<void **>(p);
+	return p;
+    }
+}
+
+template <std::size_t N, std::size_t Align = CLASS_ALIGN>
+inline void free(void *p)
+{
+    constexpr int c = class_of(N);
+
+    if constexpr (Align > CLASS_ALIGN || c == NUM_CLASSES) {
+	mm_free_sized(p, N);
+    } else {
+	bin &b = bins[c];
+
+	*static_cast<void **>(p) = b.head;
+	b.head = p;
+    }
+}
+
+template <typename T, typename... Args>
+inline T *make(Args &&...args)
+{
+    void *p = alloc<sizeof(T), alignof(T)>();
+
+    if (p == nullptr)
+	return nullptr;
+#if defined(__cpp_exceptions)
+    try {
+	return new (p) T(std::forward<Args>(args)...);
+    } catch (...) {
+	free<sizeof(T), alignof(T)>(p);
+	throw;
+    }
+#else
+    return new (p) T(std::forward<Args>(args)...);
+#endif
+}
+
+template <typename T>
+inline void destroy(T *t)
+{
+    if (t == nullptr)
+	return;
+    t->~T();
+    free<sizeof(T), alignof(T)>(t);
+}
+
+} // namespace mm
+
+#endif /* __MMTYPED_HPP_ */
@@ -0,0 +1,344 @@
+/*
+ * mtrace.c - Analyse .rep traces and bound the utilization they allow
+ *
+ * For each trace mtrace reports:
+ *   - the histogram of request sizes (power-of-two buckets),
+ *   - the lifetime of blocks, in ops from alloc to free, per size bucket,
+ *   - the curve of live payload bytes over the trace and its peak,
+ *   - the realloc growth chains (blocks that are reallocated),
+ *   - lower bounds on the heap any placement could reach, and the
+ *     utilization mm.c actually reaches on the trace.
+ *
+ * The driver's utilization is peak live payload / final heap size.
+ * Finding the optimal offline placement is NP-hard, but no placement,
+ * however clairvoyant, can use less heap than the peak live payload,
+ * nor less than the peak live *block* bytes once every block pays
+ * mm.c's boundary tags, alignment and minimum block size. Those two
+ * bounds give the headroom left for an allocator change.
+ *
+ * usage: mtrace [-h] [-n <points>] [-k <chains>] <trace>...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "trace.h"
+#include "mm.h"
+#include "memlib.h"
+#include "config.h"
+
+#define NBUCKETS 32            /* power-of-two size buckets */
+#define MIN_BLOCK 24           /* mm.c: smallest block */
+#define TAGS 8                 /* mm.c: header + footer */
+#define BAR 50                 /* width of the live-bytes bars */
+
+/* Per-id state while walking a trace */
+typedef struct {
+    int birth;                 /* op that allocated the block, -1 if none */
+    int size;                  /* current payload size */
+    int bucket;                /* size bucket at allocation */
+    int reallocs;              /* length of the realloc chain */
+    int first_size, max_size;
+} blockinfo_t;
+
+static int num_points = 20;    /* -n: points on the live-bytes curve */
+static int num_chains = 5;     /* -k: realloc chains shown */
+
+static void usage(void);
+
+/*
+ * bucket_of - Power-of-two bucket of a request size: [2^b, 2^(b+1))
+ */
+static int bucket_of(int size)
+{
+    int b = 0;
+
+    while (size > 1 && b < NBUCKETS - 1) {
+	size >>= 1;
+	b++;
+    }
+    return b;
+}
+
+/*
+ * block_size - Bytes mm.c spends on a request of size bytes
+ */
+static long block_size(int size)
+{
+    long asize = ((long)size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT + TAGS;
+
+    return asize < MIN_BLOCK ? MIN_BLOCK : asize;
+}
+
+/* A freed block's lifetime, sorted by size bucket then lifetime */
+typedef struct {
+    int bucket;
+    int ops;
+} lifetime_t;
+
+static int cmp_lifetime(const void *a, const void *b)
+{
+    const lifetime_t *x = a, *y = b;
+
+    if (x->bucket != y->bucket)
+	return x->bucket - y->bucket;
+    return x->ops - y->ops;
+}
+
+/*
+ * replay_util - Run the trace through mm.c and return its utilization
+ *     (peak payload / heap size), or -1 if the allocator failed
+ */
+static double replay_util(trace_t *trace)
+{
+    char **blocks;
+    int *sizes;
+    long live = 0, peak = 0;
+    double util = -1;
+    int i;
+
+    blocks = calloc(trace->num_ids, sizeof(char *));
+    sizes = calloc(trace->num_ids, sizeof(int));
+    if (blocks == NULL || sizes == NULL)
+	goto out;
+    mem_reset_brk();
+    if (mm_init() < 0)
+	goto out;
+    for (i = 0; i < trace->num_ops; i++) {
+	traceop_t *op = &trace->ops[i];
+	char *p;
+
+	switch (op->type) {
+	case ALLOC:
+	case REALLOC:
+	    p = op->type == ALLOC ? mm_malloc(op->size) :
+		mm_realloc(blocks[op->index], op->size);
+	    if (p == NULL && op->size > 0)
+		goto out;
+	    if (op->type == REALLOC)
+		live -= sizes[op->index];
+	    blocks[op->index] = p;
+	    sizes[op->index] = op->size;
+	    live += op->size;
+	    break;
+	case FREE:
+	    mm_free(blocks[op->index]);
+	    live -= sizes[op->index];
+	    sizes[op->index] = 0;
+	    break;
+	}
+	if (live > peak)
+	    peak = live;
+    }
+    util = mem_heapsize() ? (double)peak / mem_heapsize() : 0;
+ out:
+    free(blocks);
+    free(sizes);
+    return util;
+}
+
+/*
+ * analyse - Print the report for one trace
+ */
+static void analyse(const char *name, trace_t *trace)
+{
+    long count[NBUCKETS] = {0}, bytes[NBUCKETS] = {0}, never[NBUCKETS] = {0};
+    int first[NBUCKETS], nlife[NBUCKETS] = {0}, nfreed = 0;
+    lifetime_t *lifetimes;
+    long *curve, live = 0, peak = 0, blive = 0, bpeak = 0;
+    int peak_op = 0, i, b, k, chained = 0, longest = 0;
+    blockinfo_t *ids;
+    double util;
+
+    ids = calloc(trace->num_ids, sizeof(blockinfo_t));
+    curve = malloc((trace->num_ops + 1) * sizeof(long));
+    lifetimes = malloc((trace->num_ops + 1) * sizeof(lifetime_t));
+    if (!ids || !curve || !lifetimes) {
+	fprintf(stderr, "mtrace: out of memory\n");
+	exit(1);
+    }
+    for (i = 0; i < trace->num_ids; i++)
+	ids[i].birth = -1;
+
+    for (i = 0; i < trace->num_ops; i++) {
+	traceop_t *op = &trace->ops[i];
+	blockinfo_t *id = &ids[op->index];
+
+	switch (op->type) {
+	case ALLOC:
+	    b = bucket_of(op->size);
+	    count[b]++;
+	    bytes[b] += op->size;
+	    id->birth = i;
+	    id->bucket = b;
+	    id->size = id->first_size = id->max_size = op->size;
+	    id->reallocs = 0;
+	    live += op->size;
+	    blive += block_size(op->size);
+	    break;
+	case REALLOC:
+	    b = bucket_of(op->size);
+	    count[b]++;
+	    bytes[b] += op->size;
+	    live += op->size - id->size;
+	    blive += block_size(op->size) - block_size(id->size);
+	    id->size = op->size;
+	    if (op->size > id->max_size)
+		id->max_size = op->size;
+	    id->reallocs++;
+	    break;
+	case FREE:
+	    if (id->birth >= 0) {
+		lifetimes[nfreed].bucket = id->bucket;
+		lifetimes[nfreed++].ops = i - id->birth;
+		nlife[id->bucket]++;
+	    }
+	    live -= id->size;
+	    blive -= block_size(id->size);
+	    id->birth = -1;
+	    break;
+	}
+	curve[i] = live;
+	if (live > peak) {
+	    peak = live;
+	    peak_op = i;
+	}
+	if (blive > bpeak)
+	    bpeak = blive;
+    }
+    for (i = 0; i < trace->num_ids; i++) {
+	if (ids[i].birth >= 0)
+	    never[ids[i].bucket]++;
+	if (ids[i].reallocs > 0)
+	    chained++;
+	if (ids[i].reallocs > longest)
+	    longest = ids[i].reallocs;
+    }
+
+    qsort(lifetimes, nfreed, sizeof(lifetime_t), cmp_lifetime);
+    for (b = 0, k = 0; b < NBUCKETS; k += nlife[b++])
+	first[b] = k;
+
+    printf("\n=== %s: %d ops, %d ids\n", name, trace->num_ops, trace->num_ids);
+
+    printf("\nRequest sizes and block lifetimes (ops from alloc to free):\n");
+    printf("%12s %8s %6s %12s %8s %8s %8s %8s\n", "size", "requests", "%",
+	   "bytes", "median", "p90", "max", "unfreed");
+    for (b = 0; b < NBUCKETS; b++) {
+	lifetime_t *lt = &lifetimes[first[b]];
+	int n = nlife[b];
+
+	if (count[b] == 0)
+	    continue;
+	printf("%5ld-%-6ld %8ld %5.1f%% %12ld", b ? 1L << b : 0L,
+	       (1L << (b + 1)) - 1, count[b],
+	       100.0 * count[b] / trace->num_ops, bytes[b]);
+	if (n > 0)
+	    printf(" %8d %8d %8d", lt[n / 2].ops, lt[(int)(n * 0.9)].ops,
+		   lt[n - 1].ops);
+	else
+	    printf(" %8s %8s %8s", "-", "-", "-");
+	printf(" %8ld\n", never[b]);
+    }
+
+    printf("\nLive payload bytes (max over each slice of the trace):\n");
+    for (k = 0; k < num_points && trace->num_ops > 0; k++) {
+	int lo = (long)trace->num_ops * k / num_points;
+	int hi = (long)trace->num_ops * (k + 1) / num_points;
+	long m = 0;
+
+	for (i = lo; i < hi; i++)
+	    if (curve[i] > m)
+		m = curve[i];
+	if (hi == lo)
+	    continue;
+	printf("%8d %10ld |", lo, m);
+	for (i = 0; peak && i < m * BAR / peak; i++)
+	    putchar('#');
+	printf("\n");
+    }
+    printf("peak %ld bytes at op %d\n", peak, peak_op);
+
+    printf("\nRealloc chains: %d ids reallocated, longest chain %d\n",
+	   chained, longest);
+    for (k = 0; k < num_chains && chained > 0; k++) {
+	int best = -1;
+
+	for (i = 0; i < trace->num_ids; i++)
+	    if (ids[i].reallocs > 0 &&
+		(best < 0 || ids[i].reallocs > ids[best].reallocs))
+		best = i;
+	if (best < 0)
+	    break;
+	printf("  id %-6d %6d reallocs  %8d -> %-8d bytes (max %d)\n", best,
+	       ids[best].reallocs, ids[best].first_size, ids[best].size,
+	       ids[best].max_size);
+	ids[best].reallocs = -ids[best].reallocs;  /* taken */
+    }
+
+    util = replay_util(trace);
+    printf("\nUtilization bounds:\n");
+    printf("  peak live payload             %10ld bytes  (any placement: util <= 100%%)\n",
+	   peak);
+    printf("  peak live blocks (mm.c tags)  %10ld bytes  (util <= %.1f%%)\n",
+	   bpeak, bpeak ? 100.0 * peak / bpeak : 0);
+    if (util >= 0)
+	printf("  mm.c                          %10lu bytes  util %.1f%%, headroom %.1f%% (%.1f%% with tags)\n",
+	       (unsigned long)mem_heapsize(), 100.0 * util, 100.0 * (1 - util),
+	       bpeak ? 100.0 * ((double)peak / bpeak - util) : 0);
+    else
+	printf("  mm.c failed to replay the trace\n");
+
+    free(lifetimes);
+    free(curve);
+    free(ids);
+}
+
+int main(int argc, char **argv)
+{
+    trace_t *trace;
+    int c;
+
+    while ((c = getopt(argc, argv, "hn:k:")) != EOF) {
+	switch (c) {
+	case 'n':
+	    num_points = atoi(optarg);
+	    break;
+	case 'k':
+	    num_chains = atoi(optarg);
+	    break;
+	case 'h':
+	default:
+	    usage();
+	    exit(c == 'h' ? 0 : 1);
+	}
+    }
+    if (optind == argc || num_points <= 0) {
+	usage();
+	exit(1);
+    }
+
+    mem_init();
+    for (; optind < argc; optind++) {
+	if ((trace = read_trace(NULL, argv[optind])) == NULL)
+	    exit(1);
+	analyse(argv[optind], trace);
+	free_trace(trace);
+    }
+    mem_deinit();
+    return 0;
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mtrace [-h] [-n <points>] [-k <chains>] <trace>...\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h           Print this message.\n");
+    fprintf(stderr, "\t-n <points>  Points on the live-bytes curve (default 20).\n");
+    fprintf(stderr, "\t-k <chains>  Longest realloc chains to list (default 5).\n");
+}
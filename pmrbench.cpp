@@ -0,0 +1,229 @@
+/*
+ * pmrbench.cpp - Container workloads on the C++ adapters (mmpmr.hpp)
+ *     against libc malloc
+ *
+ * Each workload runs with the containers' allocator chosen by -a:
+ *
+ *   libc      std::pmr::new_delete_resource() (operator new, malloc)
+ *   mm        mm::heap_resource()
+ *   arena     mm::arena_resource, released after each round
+ *   pool      mm::pool_resource sized for the map's nodes
+ *   stateless mm::allocator<T> instead of polymorphic_allocator
+ *
+ * and the workloads are:
+ *
+ *   vector    push_back of n ints into each of 64 vectors
+ *   map       n inserts into an unordered_map<int,int>, half erased
+ *   string    n strings of 8 to 200 characters, appended to
+ *
+ * The time per round (ns per element) is the median over the rounds.
+ * Then n objects of OBJ_SIZE bytes are allocated and freed with
+ * mm_malloc, from an mm_pool_t and with mm::alloc<OBJ_SIZE> (mmtyped.hpp).
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <memory_resource>
+#include <unistd.h>
+
+#include "mmpmr.hpp"
+#include "mmtyped.hpp"
+
+extern "C" {
+#include "memlib.h"
+}
+
+static int rounds = 11;         /* -r: rounds of each workload */
+static int n = 20000;           /* -n: elements per round */
+static volatile std::size_t sink;
+static std::vector<void *> objs;  /* the objects of the object workloads */
+
+#define OBJ_SIZE 48
+
+/* The size of an unordered_map<int,int> node: a link and the pair */
+struct map_node {
+    void *next;
+    std::pair<const int, int> value;
+};
+
+template <template <typename> class A>
+static void vectors()
+{
+    std::vector<std::vector<int, A<int>>, A<std::vector<int, A<int>>>> vs(64);
+
+    for (int i = 0; i < n; i++)
+	vs[i % 64].push_back(i);
+    sink += vs[0].size();
+}
+
+template <template <typename> class A>
+static void maps()
+{
+    using pair_t = std::pair<const int, int>;
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+		       A<pair_t>> m;
+    unsigned s = 1;
+
+    for (int i = 0; i < n; i++) {
+	s = s * 1103515245 + 12345;
+	m[(int)(s >> 8)] = i;
+	if (i & 1)
+	    m.erase(m.begin());
+    }
+    sink += m.size();
+}
+
+template <template <typename> class A>
+static void strings()
+{
+    using string_t = std::basic_string<char, std::char_traits<char>, A<char>>;
+    std::vector<string_t, A<string_t>> v;
+    unsigned s = 1;
+
+    for (int i = 0; i < n; i++) {
+	s = s * 1103515245 + 12345;
+	v.emplace_back(8 + (s >> 8) % 192, 'x');
+	v[(s >> 16) % v.size()] += "appended";
+    }
+    sink += v.size();
+}
+
+static void objects_malloc()
+{
+    for (int i = 0; i < n; i++)
+	objs[i] = mm_malloc(OBJ_SIZE);
+    for (int i = 0; i < n; i++)
+	mm_free(objs[i]);
+}
+
+static mm_pool_t *obj_pool;
+
+static void objects_pool()
+{
+    for (int i = 0; i < n; i++)
+	objs[i] = mm_pool_alloc(obj_pool);
+    for (int i = 0; i < n; i++)
+	mm_pool_free(obj_pool, objs[i]);
+}
+
+static void objects_typed()
+{
+    for (int i = 0; i < n; i++)
+	objs[i] = mm::alloc<OBJ_SIZE>();
+    for (int i = 0; i < n; i++)
+	mm::free<OBJ_SIZE>(objs[i]);
+}
+
+/*
+ * time_ns - Median ns per element of work over the rounds; after
+ *     each round, if arena is set, the arena is released
+ */
+static double time_ns(void (*work)(), mm::arena_resource *arena)
+{
+    std::vector<double> t;
+
+    for (int r = 0; r < rounds; r++) {
+	auto t0 = std::chrono::steady_clock::now();
+	work();
+	auto t1 = std::chrono::steady_clock::now();
+	t.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / n);
+	if (arena != nullptr)
+	    arena->release();
+    }
+    std::sort(t.begin(), t.end());
+    return t[t.size() / 2];
+}
+
+static void usage()
+{
+    std::fprintf(stderr, "Usage: pmrbench [-h] [-a <alloc>] [-n <n>] [-r <rounds>]\n");
+    std::fprintf(stderr, "Options\n");
+    std::fprintf(stderr, "\t-a <alloc>  libc, mm, arena, pool or stateless (default: all).\n");
+    std::fprintf(stderr, "\t-h          Print this message.\n");
+    std::fprintf(stderr, "\t-n <n>      Elements per round (default 20000).\n");
+    std::fprintf(stderr, "\t-r <rounds> Rounds of each workload (default 11).\n");
+}
+
+int main(int argc, char **argv)
+{
+    static const char *all[] = { "libc", "mm", "arena", "pool", "stateless" };
+    const char *only = nullptr;
+    int c;
+
+    while ((c = getopt(argc, argv, "ha:n:r:")) != EOF) {
+	switch (c) {
+	case 'a':
+	    only = optarg;
+	    break;
+	case 'n':
+	    n = std::atoi(optarg);
+	    break;
+	case 'r':
+	    rounds = std::atoi(optarg);
+	    break;
+	case 'h':
+	default:
+	    usage();
+	    std::exit(c == 'h' ? 0 : 1);
+	}
+    }
+    if (n <= 0 || rounds <= 0) {
+	usage();
+	std::exit(1);
+    }
+
+    mem_init();
+    if (mm_init() < 0) {
+	std::fprintf(stderr, "pmrbench: mm_init failed\n");
+	std::exit(1);
+    }
+    std::printf("%-10s %10s %10s %10s   (ns/element)\n",
+		"alloc", "vector", "map", "string");
+    for (const char *name : all) {
+	if (only != nullptr && std::strcmp(only, name) != 0)
+	    continue;
+	double tv, tm, ts;
+
+	if (std::strcmp(name, "stateless") == 0) {
+	    tv = time_ns(vectors<mm::allocator>, nullptr);
+	    tm = time_ns(maps<mm::allocator>, nullptr);
+	    ts = time_ns(strings<mm::allocator>, nullptr);
+	} else {
+	    mm::arena_resource arena;
+	    mm::pool_resource pool(sizeof(map_node), alignof(map_node));
+	    std::pmr::memory_resource *res = std::pmr::new_delete_resource();
+
+	    if (std::strcmp(name, "mm") == 0)
+		res = mm::heap_resource();
+	    else if (std::strcmp(name, "arena") == 0)
+		res = &arena;
+	    else if (std::strcmp(name, "pool") == 0)
+		res = &pool;
+	    std::pmr::set_default_resource(res);
+	    mm::arena_resource *a = res == &arena ? &arena : nullptr;
+	    tv = time_ns(vectors<std::pmr::polymorphic_allocator>, a);
+	    tm = time_ns(maps<std::pmr::polymorphic_allocator>, a);
+	    ts = time_ns(strings<std::pmr::polymorphic_allocator>, a);
+	    std::pmr::set_default_resource(nullptr);
+	}
+	std::printf("%-10s %10.1f %10.1f %10.1f\n", name, tv, tm, ts);
+    }
+
+    objs.resize(n);
+    if ((obj_pool = mm_pool_create(OBJ_SIZE, 0)) == nullptr) {
+	std::fprintf(stderr, "pmrbench: cannot create a pool\n");
+	std::exit(1);
+    }
+    std::printf("\n%d byte objects, alloc+free (ns/object)\n", OBJ_SIZE);
+    std::printf("%-20s %10.1f\n", "mm_malloc", time_ns(objects_malloc, nullptr));
+    std::printf("%-20s %10.1f\n", "mm_pool_alloc", time_ns(objects_pool, nullptr));
+    std::printf("%-20s %10.1f\n", "mm::alloc<N>", time_ns(objects_typed, nullptr));
+    mm_pool_destroy(obj_pool);
+    mem_deinit();
+    return (int)(sink & 0);
+}
@@ -0,0 +1,148 @@
+/*
+ * trace.c - Read .rep trace files
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+#define MAXLINE 1024
+
+/*
+ * read_binary - Read the rest of a binary trace, after its magic
+ */
+static trace_t *read_binary(const char *path, FILE *tracefile, trace_t *trace)
+{
+    int header[4], i;
+
+    if (fread(header, sizeof(int), 4, tracefile) != 4 ||
+	header[1] < 0 || header[2] < 0) {
+	fprintf(stderr, "%s: bad trace header\n", path);
+	goto fail;
+    }
+    trace->sugg_heapsize = header[0];
+    trace->num_ids = header[1];
+    trace->num_ops = header[2];
+    trace->weight = header[3];
+    if ((trace->ops = malloc(trace->num_ops * sizeof(traceop_t) + 1)) == NULL) {
+	fprintf(stderr, "malloc 2 failed in read_trace\n");
+	goto fail;
+    }
+    if (fread(trace->ops, sizeof(traceop_t), trace->num_ops, tracefile) !=
+	(size_t)trace->num_ops) {
+	fprintf(stderr, "%s: truncated trace\n", path);
+	goto fail;
+    }
+    for (i = 0; i < trace->num_ops; i++) {
+	traceop_t *op = &trace->ops[i];
+
+	if (op->index < 0 || op->index >= trace->num_ids || op->size < 0 ||
+	    (op->type != ALLOC && op->type != FREE && op->type != REALLOC)) {
+	    fprintf(stderr, "%s: bad request at op %d\n", path, i);
+	    goto fail;
+	}
+    }
+    fclose(tracefile);
+    return trace;
+
+ fail:
+    fclose(tracefile);
+    free_trace(trace);
+    return NULL;
+}
+
+/*
+ * read_trace - Read a trace file and store it in memory
+ */
+trace_t *read_trace(const char *tracedir, const char *filename)
+{
+    FILE *tracefile;
+    trace_t *trace;
+    char type[MAXLINE];
+    char path[MAXLINE];
+    int index, size, op_index = 0;
+
+    if (tracedir != NULL)
+	snprintf(path, sizeof(path), "%s%s", tracedir, filename);
+    else
+	snprintf(path, sizeof(path), "%s", filename);
+
+    if ((trace = calloc(1, sizeof(trace_t))) == NULL) {
+	fprintf(stderr, "malloc 1 failed in read_trace\n");
+	return NULL;
+    }
+    if ((tracefile = fopen(path, "rb")) == NULL) {
+	fprintf(stderr, "Could not open %s in read_trace\n", path);
+	free(trace);
+	return NULL;
+    }
+    if (fread(type, 1, strlen(TRACE_MAGIC), tracefile) == strlen(TRACE_MAGIC) &&
+	memcmp(type, TRACE_MAGIC, strlen(TRACE_MAGIC)) == 0)
+	return read_binary(path, tracefile, trace);
+    rewind(tracefile);
+
+    if (fscanf(tracefile, "%d %d %d %d", &trace->sugg_heapsize,
+	       &trace->num_ids, &trace->num_ops, &trace->weight) != 4 ||
+	trace->num_ids < 0 || trace->num_ops < 0) {
+	fprintf(stderr, "%s: bad trace header\n", path);
+	goto fail;
+    }
+    if ((trace->ops = malloc(trace->num_ops * sizeof(traceop_t) + 1)) == NULL) {
+	fprintf(stderr, "malloc 2 failed in read_trace\n");
+	goto fail;
+    }
+
+    while (fscanf(tracefile, "%s", type) != EOF) {
+	if (op_index == trace->num_ops) {
+	    fprintf(stderr, "%s: more ops than the header says\n", path);
+	    goto fail;
+	}
+	switch (type[0]) {
+	case 'a':
+	case 'r':
+	    if (fscanf(tracefile, "%d %d", &index, &size) != 2)
+		goto bad_op;
+	    trace->ops[op_index].type = type[0] == 'a' ? ALLOC : REALLOC;
+	    trace->ops[op_index].size = size;
+	    break;
+	case 'f':
+	    if (fscanf(tracefile, "%d", &index) != 1)
+		goto bad_op;
+	    size = 0;
+	    trace->ops[op_index].type = FREE;
+	    trace->ops[op_index].size = 0;
+	    break;
+	default:
+	    goto bad_op;
+	}
+	if (index < 0 || index >= trace->num_ids || size < 0)
+	    goto bad_op;
+	trace->ops[op_index].index = index;
+	op_index++;
+    }
+    fclose(tracefile);
+    if (op_index != trace->num_ops) {
+	fprintf(stderr, "%s: %d ops, header says %d\n", path, op_index,
+		trace->num_ops);
+	free_trace(trace);
+	return NULL;
+    }
+    return trace;
+
+ bad_op:
+    fprintf(stderr, "%s: bad request at op %d\n", path, op_index);
+ fail:
+    fclose(tracefile);
+    free_trace(trace);
+    return NULL;
+}
+
+/*
+ * free_trace - Free the trace record and the op array it points to
+ */
+void free_trace(trace_t *trace)
+{
+    free(trace->ops);
+    free(trace);
+}
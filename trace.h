@@ -0,0 +1,48 @@
+/*
+ * trace.h - reading the .rep trace files used by the driver and tools
+ *
+ * A trace file starts with four numbers: suggested heap size (unused),
+ * number of block ids, number of ops and weight (unused). Each op is
+ * one line:
+ *
+ *     a <id> <size>    allocate a block of size bytes for id
+ *     r <id> <size>    reallocate the block of id to size bytes
+ *     f <id>           free the block of id
+ *
+ * Binary traces (see mgen -b) hold the same data: TRACE_MAGIC, the
+ * four header numbers as ints and num_ops traceop_t records, all in
+ * the byte order of the machine that wrote them.
+ */
+#ifndef __TRACE_H_
+#define __TRACE_H_
+
+#define TRACE_MAGIC "MMTRACE1"
+
+/* One request of a trace */
+typedef enum { ALLOC, FREE, REALLOC } optype_t;
+
+typedef struct {
+    optype_t type;   /* type of request */
+    int index;       /* id of the block the request applies to */
+    int size;        /* byte size of alloc/realloc request */
+} traceop_t;
+
+typedef struct {
+    int sugg_heapsize;   /* suggested heap size (unused) */
+    int num_ids;         /* number of alloc/realloc ids */
+    int num_ops;         /* number of distinct requests */
+    int weight;          /* weight for this trace (unused) */
+    traceop_t *ops;      /* array of requests */
+} trace_t;
+
+/*
+ * read_trace - Read a text or binary trace file. filename is taken relative to
+ *     tracedir unless tracedir is NULL. Returns NULL (after printing
+ *     the reason) if the file cannot be read or is malformed.
+ */
+trace_t *read_trace(const char *tracedir, const char *filename);
+
+/* free_trace - Free a trace returned by read_trace */
+void free_trace(trace_t *trace);
+
+#endif /* __TRACE_H_ */